@@ -0,0 +1,124 @@
+// Binary file formats
+//
+// A binary dataset file is written once from a libsvm text file and then
+// memory mapped for training, the compressed column arrays are used in
+// place through Eigen::Map without any heap copy.
+//
+// Layout of binary dataset file (native byte order):
+//
+//     DatasetFileHeader
+//     outer index  [n_samples + 1]  SpColMatrix::StorageIndex
+//     inner index  [nnz]            SpColMatrix::StorageIndex
+//     values       [nnz]            SpColMatrix::Scalar, absent for
+//                                    binary features (kBinaryFeatures)
+//     y            [n_samples]      double
+//     labels       [n_classes]      double
+//
+// Layout of binary model file (native byte order):
+//
+//     ModelFileHeader
+//     labels       [n_classes]             double
+//     weights      [dimension * n_ws]      double, Model::W_ layout
+//                  [n_rows * n_ws]         for sparse model (kSparseModel)
+//                                          int8 (kInt8Weights) or fp16
+//                                          (kFp16Weights) if quantized
+//     index        [2 * ceil(dimension / 64)]
+//                                          uint64_t, sparse model only
+//     scales       [ceil(rows / kQuantBlock)]
+//                                          float, int8 model only
+//
+// where n_ws is 1 for binary classification, else n_classes. The file is
+// memory mapped when loading and the weights (and the index of sparse
+// model, see Model::add_weights) are used in place.
+//
+// Every section starts at the offset recorded in header, which is
+// aligned to kBinaryAlignment bytes.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_BINARY_IO_H_
+#define OPENLINEAR_BINARY_IO_H_
+
+#include <stdint.h>
+#include "linear.hpp"
+
+namespace oplin{
+
+/** alignment of sections in binary files */
+const size_t kBinaryAlignment = 64;
+/** current version of binary dataset file */
+const uint32_t kDatasetFileVersion = 1;
+/** flag of binary dataset file without values, all features are 1 */
+const uint32_t kBinaryFeatures = 1;
+/** current version of binary model file */
+const uint32_t kModelFileVersion = 3;
+/**
+ * flags of binary model file of softmax model, of sparse model and of
+ * quantized weights (see Model::quantize)
+ */
+const uint32_t kMultinomialModel = 1;
+const uint32_t kSparseModel = 2;
+const uint32_t kInt8Weights = 4;
+const uint32_t kFp16Weights = 8;
+
+/// Header of binary dataset file
+struct DatasetFileHeader
+{
+    /** "OPLINDAT" */
+    char magic[8];
+    uint32_t version;
+    /** size of index and value types, checked when loading */
+    uint32_t index_size;
+    uint32_t value_size;
+    /** kBinaryFeatures or 0 */
+    uint32_t flags;
+    uint64_t n_samples;
+    uint64_t n_classes;
+    uint64_t dimension;
+    uint64_t nnz;
+    double bias;
+    /** section offsets from the beginning of file */
+    uint64_t outer_offset;
+    uint64_t inner_offset;
+    uint64_t value_offset;
+    uint64_t y_offset;
+    uint64_t labels_offset;
+    uint64_t file_size;
+};
+
+/// Header of binary model file
+struct ModelFileHeader
+{
+    /** "OPLINMDL" */
+    char magic[8];
+    uint32_t version;
+    /** kMultinomialModel | kSparseModel | kInt8Weights or kFp16Weights, or 0 */
+    uint32_t flags;
+    uint64_t n_classes;
+    uint64_t dimension;
+    /** features of non-zero weights of sparse model, 0 for dense model */
+    uint64_t n_rows;
+    double bias;
+    /** section offsets from the beginning of file */
+    uint64_t labels_offset;
+    uint64_t weights_offset;
+    uint64_t index_offset;
+    uint64_t scales_offset;
+    uint64_t file_size;
+};
+
+bool is_binary_dataset(const std::string&);
+void save_dataset_binary(const DatasetPtr, const std::string&);
+DatasetPtr load_dataset_binary(const std::string&);
+void check_dataset_header(const DatasetFileHeader&, uint64_t);
+void check_dataset_outer(const DatasetFileHeader&, uint64_t, uint64_t);
+bool is_binary_model(const std::string&);
+void save_model_binary(const Model&, const std::string&);
+ModelUniPtr load_model_binary(const std::string&);
+
+} // oplin
+
+#endif// OPENLINEAR_BINARY_IO_H_
@@ -18,6 +18,7 @@
 #define OPENLINEAR_FORMULA_H_
 
 #include "linear.hpp"
+#include "stream.hpp"
 
 namespace oplin{
 
@@ -29,6 +30,8 @@ public:
     virtual ~Regularizer(void) {};
     virtual double loss(const Eigen::Ref<const ColVector>&) = 0;
     virtual void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>) = 0;
+    virtual void hessian_vector(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&,
+                                Eigen::Ref<ColVector>) = 0;
 };
 typedef std::shared_ptr<Regularizer> RegularizerPtr;
 
@@ -39,6 +42,8 @@ public:
     virtual ~L1_Regularizer(void) {};
     double loss(const Eigen::Ref<const ColVector>&);
     void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    void hessian_vector(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&,
+                        Eigen::Ref<ColVector>);
 };
 
 class L2_Regularizer : public Regularizer
@@ -47,6 +52,8 @@ public:
     virtual ~L2_Regularizer(void) {};
     double loss(const Eigen::Ref<const ColVector>&);
     void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    void hessian_vector(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&,
+                        Eigen::Ref<ColVector>);
 };
 
 /// A general convex regularization problem
@@ -59,15 +66,48 @@ public:
 
     virtual double loss(const Eigen::Ref<const ColVector>&) = 0;
     virtual void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>) = 0;
+    virtual double loss_and_gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
     virtual void regularized_gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
-    virtual void update_weights(Eigen::Ref<ColVector>, const Eigen::Ref<const ColVector>&,
+    virtual bool update_weights(Eigen::Ref<ColVector>, const Eigen::Ref<const ColVector>&,
                                 const Eigen::Ref<const ColVector>&, const double&);
+    // directional evaluation on w + alpha * p for line search
+    virtual bool init_direction(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&);
+    virtual double directional_loss(const Eigen::Ref<const ColVector>&, const double&);
+    // Hessian-vector products at the point of last gradient evaluation
+    virtual bool init_hessian();
+    virtual void hessian_vector(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&,
+                                Eigen::Ref<ColVector>);
+    virtual void regularized_hessian_vector(const Eigen::Ref<const ColVector>&,
+                                            const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    // derivative of a single sample loss on its decision value
+    virtual double sample_derivative(size_t, double);
+    virtual void set_n_threads(size_t);
 
     const DatasetPtr dataset_;
 
 protected:
     std::vector<double> C_;
     RegularizerPtr regularizer_;
+    /** number of threads for evaluations, 0 for all cores */
+    size_t n_threads_;
+
+    // Each thread takes a range of samples (columns of X) of about the
+    // same number of non-zeros. w^T X needs no synchronization, while
+    // for X z each thread sums into its own partial gradient, which are
+    // reduced over ranges of weights at the end.
+    /** sample ranges of threads */
+    std::vector<size_t> sample_bounds_;
+    /** weight ranges of threads for the reduction of gradients */
+    std::vector<size_t> feature_bounds_;
+    /** partial gradients of thread 1, 2, ..., thread 0 uses the output */
+    std::vector<ColVector> partial_grad_;
+    /** partial losses of threads, thread 0 starts from regularization loss */
+    std::vector<double> partial_loss_;
+
+    /** number of weights, the size of gradient */
+    virtual size_t n_weights() const;
+    double sum_partial_loss();
+    void reduce_partial_grad(Eigen::Ref<ColVector>);
 };
 
 
@@ -87,10 +127,28 @@ public:
 
     double loss(const Eigen::Ref<const ColVector>&);
     void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    double loss_and_gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    bool init_direction(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&);
+    double directional_loss(const Eigen::Ref<const ColVector>&, const double&);
+    bool init_hessian();
+    void hessian_vector(const Eigen::Ref<const ColVector>&, const Eigen::Ref<const ColVector>&,
+                        Eigen::Ref<ColVector>);
+    double sample_derivative(size_t, double);
 
 protected:
     /** z are some reusable part of the processes */
     ColVector z_;
+    /** w^T X and p^T X cached for directional evaluation */
+    ColVector wTX_;
+    ColVector pTX_;
+    /**
+     * diagonal D_ii = C_i * sigmoid(y_i z_i) * (1 - sigmoid(y_i z_i)) of
+     * Hessian X D X^T, updated by gradient evaluations once allocated by
+     * init_hessian
+     */
+    ColVector D_;
+
+    void update_hessian_diag(size_t, size_t);
 };
 
 /// L1-Regularized Loss Logistic Regression
@@ -101,7 +159,7 @@ class L1R_LR_Problem : public LR_Problem
 public:
     explicit L1R_LR_Problem(DatasetPtr, const std::vector<double>&);
     ~L1R_LR_Problem();
-    void update_weights(Eigen::Ref<ColVector>, const Eigen::Ref<const ColVector>&,
+    bool update_weights(Eigen::Ref<ColVector>, const Eigen::Ref<const ColVector>&,
                         const Eigen::Ref<const ColVector>&, const double&);
 
 };
@@ -115,6 +173,106 @@ public:
     ~L2R_LR_Problem();
 };
 
+/// Multinomial (softmax) logistic regression
+///
+/// All K weight vectors are optimized jointly as one vector of
+/// dimension * K weights, where the weights of feature j are the block
+/// w[j * K, (j + 1) * K), the same interleaved layout as Model::W_. The K
+/// scores of a sample are then computed in one pass over its non-zeros,
+/// each of which reads a contiguous block of K weights.
+///
+/// The targets y of dataset are class indices 0, 1, ..., K - 1.
+///
+class Multinomial_LR_Problem : public Problem
+{
+
+public:
+    explicit Multinomial_LR_Problem(DatasetPtr, const std::vector<double>&, size_t);
+    ~Multinomial_LR_Problem();
+
+    double loss(const Eigen::Ref<const ColVector>&);
+    void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    double loss_and_gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+
+protected:
+    /** number of classes */
+    const size_t n_classes_;
+
+    size_t n_weights() const;
+    double evaluate(const Eigen::Ref<const ColVector>&, double*);
+};
+
+/// L1-Regularized Multinomial Logistic Regression
+///
+class L1R_Multinomial_LR_Problem : public Multinomial_LR_Problem
+{
+
+public:
+    explicit L1R_Multinomial_LR_Problem(DatasetPtr, const std::vector<double>&, size_t);
+    ~L1R_Multinomial_LR_Problem();
+    bool update_weights(Eigen::Ref<ColVector>, const Eigen::Ref<const ColVector>&,
+                        const Eigen::Ref<const ColVector>&, const double&);
+};
+
+/// L2-Regularized Multinomial Logistic Regression
+///
+class L2R_Multinomial_LR_Problem : public Multinomial_LR_Problem
+{
+
+public:
+    explicit L2R_Multinomial_LR_Problem(DatasetPtr, const std::vector<double>&, size_t);
+    ~L2R_Multinomial_LR_Problem();
+};
+
+/// Logistic regression over a dataset streamed from disk
+///
+/// The features are never held in memory as a whole, every evaluation is
+/// a pass over the blocks of a DatasetStream, and the samples of a block
+/// are split among threads as LR_Problem does on the whole X. The dataset
+/// gives the targets y of all samples, its X is not used.
+///
+class Streaming_LR_Problem : public Problem
+{
+
+public:
+    explicit Streaming_LR_Problem(DatasetPtr, DatasetStreamPtr, const std::vector<double>&);
+    ~Streaming_LR_Problem();
+
+    double loss(const Eigen::Ref<const ColVector>&);
+    void gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    double loss_and_gradient(const Eigen::Ref<const ColVector>&, Eigen::Ref<ColVector>);
+    void set_n_threads(size_t);
+
+protected:
+    DatasetStreamPtr stream_;
+    /** w^T x_i of the samples of current block */
+    ColVector z_;
+
+    double evaluate(const Eigen::Ref<const ColVector>&, double*);
+};
+
+/// L1-Regularized Streaming Logistic Regression
+///
+class L1R_Streaming_LR_Problem : public Streaming_LR_Problem
+{
+
+public:
+    explicit L1R_Streaming_LR_Problem(DatasetPtr, DatasetStreamPtr, const std::vector<double>&);
+    ~L1R_Streaming_LR_Problem();
+    bool update_weights(Eigen::Ref<ColVector>, const Eigen::Ref<const ColVector>&,
+                        const Eigen::Ref<const ColVector>&, const double&);
+};
+
+/// L2-Regularized Streaming Logistic Regression
+///
+class L2R_Streaming_LR_Problem : public Streaming_LR_Problem
+{
+
+public:
+    explicit L2R_Streaming_LR_Problem(DatasetPtr, DatasetStreamPtr, const std::vector<double>&);
+    ~L2R_Streaming_LR_Problem();
+};
+
 } // oplin
 
 #endif// OPENLINEAR_FORMULA_H_
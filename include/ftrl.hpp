@@ -0,0 +1,117 @@
+// FTRL-Proximal online logistic regression
+//
+// Follow The (Proximally) Regularized Leader learns from one sample at a
+// time in a single pass, with a learning rate adapted to every
+// coordinate by the sum of its squared gradients. The L1 regularization
+// is applied in closed form, which gives exactly sparse weights, so it
+// fits click-through-rate workloads of huge sparse (e.g. hashed, see
+// parser.hpp) feature spaces.
+//
+// Only two accumulators z and n are kept per weight, the weight itself is
+// materialized from them when a sample touches it, and for all the
+// weights only when the model is exported. The accumulators are kept for
+// the features touched by samples only, in a hash table, so the memory
+// follows the features seen rather than the dimension (e.g. 2^30 hashed
+// features).
+//
+// Reference:
+// H. Brendan McMahan, Gary Holt, D. Sculley, et al. Ad click prediction:
+// a view from the trenches. In KDD, 2013.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_FTRL_H_
+#define OPENLINEAR_FTRL_H_
+
+#include <cmath>
+#include "linear.hpp"
+
+namespace oplin{
+
+/// Accumulators of a weight, side by side to be read by one cache miss
+struct FTRLAccumulator
+{
+    /** sum of gradients, adjusted by the proximal steps */
+    double z;
+    /** sum of squared gradients */
+    double n;
+};
+
+/// FTRL-Proximal learner of binary or One-vs-Rest logistic regression
+///
+/// It minimizes sum_i C_i * loss_i(w) + l1 * |w|_1 + l2 / 2 * |w|^2, the
+/// objective of L1R_LR (l1 = 1) and L2R_LR (l2 = 1) problems.
+///
+class FTRLProximal
+{
+public:
+    FTRLProximal(size_t, const std::vector<double>&, double, double, double, double);
+
+    double learn(const FeatureNode*, size_t, double, double C = 1);
+    void learn(const SpColMatrixMap&, const size_t*, const double*);
+    void weights(double*) const;
+    ModelUniPtr export_model() const;
+
+    /** number of samples learned */
+    size_t n_samples() const { return n_samples_; }
+    /** mean loss of samples before learning them (progressive validation) */
+    double mean_loss() const { return n_samples_ ? loss_ / n_samples_ : 0; }
+    /** number of features touched by samples, which have accumulators */
+    size_t n_features() const { return n_features_; }
+
+private:
+    /** weight materialized from its accumulators */
+    double weight(const FTRLAccumulator& a) const
+    {
+        if(std::fabs(a.z) <= l1_)
+            return 0;
+        return -(a.z - std::copysign(l1_, a.z)) / ((beta_ + std::sqrt(a.n)) / alpha_ + l2_);
+    }
+    template <class Feature>
+    double update(size_t, Feature, size_t, double);
+    void reserve(size_t);
+    void rehash(size_t);
+    /** first slot probed for a feature, by Fibonacci hashing */
+    size_t home(size_t feature) const
+    {
+        if(direct_)
+            return feature;
+        return (size_t)(((uint64_t)feature * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+    size_t slot(size_t, size_t);
+
+    size_t dimension_;
+    /** weights per feature, 1 for binary classification else n_classes */
+    size_t n_ws_;
+    std::vector<double> labels_;
+    /** learning rate alpha / (beta + sqrt(n)) of every coordinate */
+    double alpha_;
+    double beta_;
+    double l1_;
+    double l2_;
+    /**
+     * open addressing hash table (linear probing) of the touched features,
+     * of a power of 2 slots at most half full: the feature of every slot,
+     * and its n_ws_ accumulators interleaved as Model::W_. Once it would
+     * take dimension_ slots, slot j holds feature j (direct_).
+     */
+    std::vector<size_t> features_;
+    std::vector<FTRLAccumulator> accumulators_;
+    size_t n_features_;
+    /** 64 - log2 of the number of slots */
+    size_t shift_;
+    bool direct_;
+    size_t n_samples_;
+    double loss_;
+    /** per sample buffers of margins, and of the weights and slots of its features */
+    std::vector<double> margins_;
+    std::vector<double> w_;
+    std::vector<size_t> slots_;
+};
+
+} // oplin
+
+#endif// OPENLINEAR_FTRL_H_
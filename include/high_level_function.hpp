@@ -9,6 +9,10 @@
 #define OPENLINEAR_HIGH_LEVEL_FUNCTION_H_
 
 #include "linear.hpp"
+#include "mapped_file.hpp"
+#include "parser.hpp"
+#include "binary_io.hpp"
+#include "parallel.hpp"
 
 #include <stdio.h>
 #include <string.h>
@@ -16,6 +20,11 @@
 #include <sstream>
 #include <set>
 #include <map>
+#include <limits>
+#include <mutex>
+#include <condition_variable>
+#include <sys/resource.h>
+#include <sys/mman.h>
 
 namespace oplin{
 using std::cout;
@@ -24,72 +33,88 @@ using std::cerr;
 using std::string;
 
 /**
- * Read dataset from file. An estimation of number of instance is better
- * to be given for better memory usage.
+ * Peak resident set size of current process.
+ *
+ * @return peak RSS in kilobytes
+ */
+size_t peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in kilobytes on linux
+    return usage.ru_maxrss;
+}
+
+/**
+ * Read dataset from file. The file is memory mapped and parsed by
+ * several threads, see parser.hpp for details. The samples are appended
+ * as columns of the compressed sparse matrix directly, so no estimation
+ * of the dataset size is needed.
+ *
+ * A binary dataset (see binary_io.hpp) is detected automatically and
+ * mapped without parsing, its bias and its hashing are fixed when it was
+ * converted.
+ *
+ * With feature hashing (see parser.hpp), the dimension is 2^bits (plus
+ * the bias feature) instead of the largest feature index.
  *
  * @param filename  input file name of dataset
- * @param n_entries estimated number of entries of datasets. Will run as
- *                  normal though not accurate but may cause memory error
- *                  because no enough space is reserved.
+ * @param bias      bias term, -1 for no bias term applied
+ * @param n_threads number of parsing threads, 0 for all cores
+ * @param hashing   feature hashing, disabled by default
  *
  * @return shared_ptr to loaded dataset
  */
 DatasetPtr
-read_dataset(const string filename, const double bias = -1, const size_t n_entries = 1000)
+read_dataset(const string filename, const double bias = -1, const size_t n_threads = 0,
+             const FeatureHashing& hashing = FeatureHashing())
 {
+    VOUT("Peak RSS before loading : %zu KB\n", peak_rss_kb());
+    check_hashing(hashing);
+    if(is_binary_dataset(filename))
+    {
+        DatasetPtr dataset = load_dataset_binary(filename);
+        if(bias != dataset->bias && (bias > 0 || dataset->bias > 0))
+        {
+            cout << "Warning : bias " << bias << " is ignored, binary dataset was converted with bias "
+                 << dataset->bias << endl;
+        }
+        if(hashing.enabled())
+            cout << "Warning : feature hashing is ignored for binary dataset" << endl;
+        VOUT("Peak RSS after loading : %zu KB\n", peak_rss_kb());
+        return dataset;
+    }
     //
     size_t n_samples = 0;
     // dimension is the length of parameters w, add w_0 if bias is applied
     size_t dimension = 0;
     size_t n_features = 0;
+    size_t nnz = 0;
 
-    std::vector<double> y;
-    y.reserve(n_entries);
-
-    // vector to store Triplets to construct sparse matrix
-    typedef Eigen::Triplet<double> Tri;
-    std::vector<Tri> triplets;
-    triplets.reserve(n_entries);
+    // parse chunks of the mapped file concurrently
+    std::vector<ParsedChunk> chunks;
+    {
+        MappedFile file(filename);
+        // the file is scanned once from the beginning to the end
+        file.advise(MADV_SEQUENTIAL);
+        parse_libsvm(file.data(), file.size(), n_threads, chunks, hashing);
+    }
 
-    // read through file;
-    std::ifstream infile(filename);
     std::set<double> classes;
-    for(string line; std::getline(infile,line);)
+    for(size_t c = 0; c < chunks.size(); ++c)
     {
-        std::stringstream ss(line);
-        string item;
-        std::getline(ss,item,' ');
-        double label = std::stod(item);
-        y.push_back(label);
-        // check if the target has been counted
-        if(classes.find(label) == classes.end())
-            classes.insert(label);
-        while(std::getline(ss,item,' '))
+        if(!chunks[c].error.empty())
         {
-            int i;
-            float v_ij;
-            // sscanf(item.c_str(),"%d:%f",&i,&v_ij);
-            i = atoi(strtok(const_cast<char*>(item.c_str()),":") );
-            v_ij = atof(strtok(NULL,":" ));
-            // feature dimension should be at least 1
-            if(i < 1)
-            {
-                cerr << "read_dataset : Bad dimension value " << i
-                     << " on line " << (n_samples+1) << ", "
-                     << __FILE__ << "," << __LINE__ << endl;
-                throw(std::exception());
-            }
-
-            // update n_feature
-            if((size_t)i > n_features)
-                n_features = i;
-
-            // j = n_samples;
-            triplets.push_back(Tri(i-1,n_samples,v_ij));
+            cerr << "read_dataset : " << chunks[c].error
+                 << " on line " << (n_samples + chunks[c].n_samples + 1) << ", "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw(std::exception());
         }
-        ++n_samples;
+        n_samples += chunks[c].n_samples;
+        nnz += chunks[c].inner.size();
+        n_features = std::max(n_features, chunks[c].n_features);
+        classes.insert(chunks[c].classes.begin(), chunks[c].classes.end());
     }
-    infile.close();
 
     // assign dataset model
     DatasetPtr dataset = std::make_shared<Dataset>();
@@ -100,17 +125,16 @@ read_dataset(const string filename, const double bias = -1, const size_t n_entri
         throw(std::bad_alloc());
     }
 
+    if(hashing.enabled())
+        n_features = hashing.dimension();
     VOUT("Auto detected n_features : %d\n" ,n_features);
 
     if(bias > 0)
     {
         dimension = n_features + 1;
         dataset->bias = bias;
-        // add bias term
-        for(size_t i = 0; i < n_samples; ++i)
-        {
-            triplets.push_back(Tri(dimension-1,i, bias));
-        }
+        // one bias term for each sample
+        nnz += n_samples;
     }
     else
     {
@@ -121,18 +145,77 @@ read_dataset(const string filename, const double bias = -1, const size_t n_entri
     dataset->n_classes = classes.size();
     dataset->dimension = dimension;
     dataset->labels = std::vector<double>(classes.begin(),classes.end());
-    dataset->y = y;
-    dataset->X = std::make_shared<SpColMatrix>(dimension,n_samples);
-    if(!dataset->X)
+    dataset->y.reserve(n_samples);
+    if(nnz > (size_t)std::numeric_limits<FeatureIndex>::max())
     {
-        cerr << "read_dataset : SpColMatrixPtr allocation failed, "
+        cerr << "read_dataset : " << nnz << " non-zeros exceed the feature index type, "
+             << "please build with LARGE_INDEX=yes, "
              << __FILE__ << "," << __LINE__ << endl;
-        throw(std::bad_alloc());
+        throw(std::overflow_error("too many non-zeros"));
     }
 
-    // assign values
-    (dataset->X)->setFromTriplets(triplets.begin(),triplets.end());
+    // no values are stored if all the features are binary
+    bool binary = bias <= 0 || bias == 1;
+    for(size_t c = 0; c < chunks.size() && binary; ++c)
+    {
+        const std::vector<FeatureScalar>& values = chunks[c].values;
+        binary = std::find_if(values.begin(), values.end(),
+                              [](FeatureScalar v){ return v != 1; }) == values.end();
+    }
+    SpColMatrixPtr mat;
+    SpColPatternPtr pattern;
+    FeatureIndex* outer;
+    FeatureIndex* inner;
+    FeatureScalar* values = NULL;
+    if(binary)
+    {
+        pattern = std::make_shared<SpColPattern>(dimension, n_samples, nnz);
+        outer = pattern->outer.data();
+        inner = pattern->inner.data();
+        VOUT("Binary features, no values are stored\n");
+    }
+    else
+    {
+        mat = std::make_shared<SpColMatrix>(dimension,n_samples);
+        mat->resizeNonZeros(nnz);
+        outer = mat->outerIndexPtr();
+        inner = mat->innerIndexPtr();
+        values = mat->valuePtr();
+    }
 
+    // fill the compressed storage column by column, each chunk is
+    // released once it is copied
+    size_t j = 0, pos = 0;
+    outer[0] = 0;
+    for(size_t c = 0; c < chunks.size(); ++c)
+    {
+        const ParsedChunk& chunk = chunks[c];
+        dataset->y.insert(dataset->y.end(), chunk.y.begin(), chunk.y.end());
+        for(size_t jj = 0; jj < chunk.n_samples; ++jj, ++j)
+        {
+            const size_t begin = chunk.outer[jj], end = chunk.outer[jj+1];
+            std::copy(chunk.inner.begin() + begin, chunk.inner.begin() + end, inner + pos);
+            if(values)
+                std::copy(chunk.values.begin() + begin, chunk.values.begin() + end, values + pos);
+            pos += end - begin;
+            // bias term is always the last feature
+            if(bias > 0)
+            {
+                inner[pos] = dimension - 1;
+                if(values)
+                    values[pos] = bias;
+                ++pos;
+            }
+            outer[j+1] = pos;
+        }
+        chunks[c] = ParsedChunk();
+    }
+    if(binary)
+        dataset->set_X(pattern);
+    else
+        dataset->set_X(mat);
+
+    VOUT("Peak RSS after loading : %zu KB\n", peak_rss_kb());
     return dataset;
 }
 
@@ -141,15 +224,17 @@ read_dataset(const string filename, const double bias = -1, const size_t n_entri
  *
  * @param lb       shared_ptr to LinearBase
  * @param filename write out file name
+ * @param binary   true to write the binary model format
  */
-void save_model(std::shared_ptr<LinearBase> lb, const string& filename)
+void save_model(std::shared_ptr<LinearBase> lb, const string& filename, bool binary = false)
 {
-    lb->export_model_to_file(filename);
+    lb->export_model_to_file(filename, binary);
 }
 
 /**
  * Load model from file. Make yourself familiar with unique_ptr
- * argument passing before using this interface
+ * argument passing before using this interface. A binary model file is
+ * memory mapped, see load_model_binary.
  *
  * @param filename inpute filename for model
  *
@@ -158,6 +243,8 @@ void save_model(std::shared_ptr<LinearBase> lb, const string& filename)
  */
 ModelUniPtr read_model(const string& filename)
 {
+    if(is_binary_model(filename))
+        return load_model_binary(filename);
 //    ModelUniPtr model = std::make_shared<Model>();
     ModelUniPtr model = std::unique_ptr<Model>(new Model);
     // sanity check
@@ -198,6 +285,11 @@ ModelUniPtr read_model(const string& filename)
             std::getline(ss,item,' ');
             model->bias = std::stod(item);
         }
+        else if(item == "multinomial")
+        {
+            std::getline(ss,item,' ');
+            model->multinomial = std::stoi(item) != 0;
+        }
         else if(item == "weights")
         {
             size_t cols;
@@ -229,6 +321,32 @@ ModelUniPtr read_model(const string& filename)
                 cerr << "Hint : dimension = n_features + 1 when bias > 0!" << endl;
                 throw(std::runtime_error("weights error!"));
             }
+            model->compact();
+        }
+        else if(item == "sparse_weights")
+        {
+            // lines of 0-based feature and its weights of classes, in
+            // ascending order of features
+            std::getline(ss,item,' ');
+            const size_t n_rows = std::stoul(item);
+            const size_t cols = model->n_classes == 2 ? 1 : model->n_classes;
+            std::vector<uint64_t> features(n_rows);
+            std::vector<double> rows(n_rows * cols);
+            for(size_t r = 0; r < n_rows; ++r)
+            {
+                infile >> features[r];
+                for(size_t j = 0; j < cols; ++j)
+                    infile >> rows[r * cols + j];
+                if(!infile || features[r] >= model->dimension || (r > 0 && features[r] <= features[r-1]))
+                {
+                    cerr << "read_model : Bad sparse weights at row " << r << ", "
+                         << __FILE__ << "," << __LINE__ << endl;
+                    throw(std::runtime_error("weights error!"));
+                }
+            }
+            // the rest of the last row
+            std::getline(infile,line);
+            model->set_sparse_weights(features, rows);
         }
         else
         {
@@ -243,28 +361,240 @@ ModelUniPtr read_model(const string& filename)
 }
 
 
+/**
+ * Append v to out as ostream << v does with the default format, that is
+ * printf "%g" of precision 6. Integers (e.g. labels) are written directly.
+ */
+void append_double(std::string& out, double v)
+{
+    char buf[32];
+    if(v > -1e6 && v < 1e6 && v == (long)v && !(v == 0 && std::signbit(v)))
+    {
+        long i = (long)v;
+        char* p = buf + sizeof(buf);
+        const bool negative = i < 0;
+        if(negative) i = -i;
+        do
+        {
+            *--p = '0' + i % 10;
+            i /= 10;
+        } while(i > 0);
+        if(negative) *--p = '-';
+        out.append(p, buf + sizeof(buf) - p);
+        return;
+    }
+    int n = snprintf(buf, sizeof(buf), "%g", v);
+    out.append(buf, n);
+}
+
+/// Block of consecutive lines in the pipeline of predict_all
+struct PredictBlock
+{
+    enum State { kEmpty, kRead, kScored };
+    State state;
+    /** input lines */
+    std::string text;
+    /** line number of the first line, from 1 */
+    size_t first_line;
+    /** predictions in output format */
+    std::string output;
+    /** warnings of the skipped lines */
+    std::string warnings;
+    PredictBlock() : state(kEmpty), first_line(0){}
+};
+
+/// Buffers of a scoring thread of predict_all
+struct PredictScorer
+{
+    std::vector<FeatureIndex> outer;
+    std::vector<FeatureIndex> inner;
+    std::vector<FeatureScalar> values;
+    std::vector<size_t> true_i;
+    std::vector<double> pred_label;
+    std::vector<double> p;
+    /** maximum feature index (1-based) of the samples */
+    long n_rows;
+    /** partial confusion matrix, [pred_i * n_classes + true_i] */
+    std::vector<size_t> confusion;
+};
+
+/**
+ * Parse the lines of a block in libsvm format, predict them by blocks of
+ * samples and format the results.
+ *
+ * @param lb               linear model
+ * @param label_index      index of every label of the model
+ * @param delim            delimiter of probabilities
+ * @param flag_probability if print out the probabilities
+ * @param block            input lines and output
+ * @param scorer           buffers and partial confusion matrix
+ * @param hashing          feature hashing, see parser.hpp
+ */
+void predict_block(LinearBase& lb, const std::map<double,size_t>& label_index,
+                   const std::string& delim, bool flag_probability,
+                   PredictBlock& block, PredictScorer& scorer, const FeatureHashing& hashing)
+{
+    const size_t batch_size = 4096;
+    const size_t n_classes = label_index.size();
+    scorer.pred_label.resize(batch_size);
+    scorer.p.resize(flag_probability ? batch_size * n_classes : 0);
+    block.output.clear();
+    block.warnings.clear();
+
+    // predict the samples parsed so far and write out the results
+    auto flush = [&]()
+    {
+        const size_t n = scorer.true_i.size();
+        if(n == 0)
+            return;
+        SpColMatrixMap X(scorer.n_rows, n, scorer.inner.size(), scorer.outer.data(),
+                         scorer.inner.data(), scorer.values.data());
+        lb.predict_batch(X, scorer.pred_label.data(), flag_probability ? scorer.p.data() : NULL);
+        for(size_t j = 0; j < n; ++j)
+        {
+            append_double(block.output, scorer.pred_label[j]);
+            if(flag_probability)
+            {
+                for(size_t i = 0; i < n_classes; ++i)
+                {
+                    block.output += delim;
+                    append_double(block.output, scorer.p[j * n_classes + i]);
+                }
+            }
+            block.output += '\n';
+            // the labels is get from model, no safty problem
+            const size_t pred_i = label_index.find(scorer.pred_label[j])->second;
+            ++scorer.confusion[pred_i * n_classes + scorer.true_i[j]];
+        }
+        scorer.outer.assign(1, 0);
+        scorer.inner.clear();
+        scorer.values.clear();
+        scorer.true_i.clear();
+        scorer.n_rows = 0;
+    };
+
+    scorer.outer.assign(1, 0);
+    scorer.inner.clear();
+    scorer.values.clear();
+    scorer.true_i.clear();
+    scorer.n_rows = 0;
+    const char* p = block.text.data();
+    const char* end = p + block.text.size();
+    for(size_t line = block.first_line; p < end; ++line)
+    {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if(!eol) eol = end;
+        while(p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if(p == eol)
+        {
+            p = eol + 1;
+            continue;
+        }
+
+        double true_label;
+        const char* q = scan_double(p, eol, true_label);
+        if(!q || (q < eol && *q != ' ' && *q != '\t' && *q != '\r'))
+        {
+            cerr << "predict_all : Bad label at line " << line << ", "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw std::runtime_error("Bad input file!");
+        }
+        std::map<double,size_t>::const_iterator it = label_index.find(true_label);
+        // if true label is not known to model, jump over
+        if(it == label_index.end())
+        {
+            std::ostringstream warning;
+            warning << "Warning: Unexpected label(" << true_label
+                    << ") to model in file, will jump the line!";
+            block.warnings += warning.str();
+            p = eol + 1;
+            continue;
+        }
+
+        for(p = q; p < eol; )
+        {
+            while(p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+            if(p == eol)
+                break;
+            long i;
+            double v_ij;
+            if(hashing.enabled())
+            {
+                size_t feature;
+                q = scan_hashed_feature(p, eol, hashing, feature, v_ij);
+                i = feature + 1;
+            }
+            else
+            {
+                q = scan_index(p, eol, i);
+                if(q && q < eol && *q == ':')
+                    q = scan_double(q + 1, eol, v_ij);
+                else
+                    q = NULL;
+            }
+            if(!q)
+            {
+                cerr << "predict_all : Bad feature at line " << line << ", "
+                     << __FILE__ << "," << __LINE__ << endl;
+                throw std::runtime_error("Bad input file!");
+            }
+            p = q;
+            // features out of the model are ignored, by predict_batch once
+            // i - 1 fits FeatureIndex, and here before as a larger i would
+            // wrap to a feature of the model
+            if(i < 1 || i - 1 > (long)std::numeric_limits<FeatureIndex>::max())
+                continue;
+            scorer.inner.push_back(i - 1);
+            scorer.values.push_back((float)v_ij);
+            scorer.n_rows = std::max(scorer.n_rows, i);
+        }
+        scorer.outer.push_back(scorer.inner.size());
+        scorer.true_i.push_back(it->second);
+        if(scorer.true_i.size() == batch_size)
+            flush();
+        p = eol + 1;
+    }
+    flush();
+}
+
 /**
  * Make prediction on all label and feature pairs of the input file.
  * If the label is not valid in the model, the predictor will jump over.
  * A confusion matrix can be recorded for evaluation.
  *
+ * The prediction is a pipeline of three stages: a reader thread cuts
+ * the file into blocks of lines, n_threads scoring threads parse, predict
+ * and format the blocks, and the calling thread writes the blocks out in
+ * the order of input.
+ *
  * @param input            input file path
  * @param output           output file path
  * @param lb               shared_ptr to a linear model
  * @param flag_probability if print out the probabilities
- * @param estimate_n       estimation of number of input feature.
- *                         this will automatically be recomputed if exceeds.
+ * @param estimate_n       estimation of number of features per sample,
+ *                         used to reserve the buffers of scoring threads
+ * @param n_threads        number of scoring threads, 0 for all cores
+ * @param hashing          feature hashing, the same as the training
+ *                         dataset was read with
  */
 void predict_all(const string& input, const string& output, std::shared_ptr<LinearBase> lb,
-                 std::string delim = " ", bool flag_probability = false, size_t estimate_n = 100)
+                 std::string delim = " ", bool flag_probability = false, size_t estimate_n = 100,
+                 size_t n_threads = 1, const FeatureHashing& hashing = FeatureHashing())
 {
+    check_hashing(hashing);
     if(!lb->is_trained())
     {
         cerr << "predict_all : Model not trained,  please train the model first!"
              << __FILE__ << "," << __LINE__ << endl;
         throw std::runtime_error("Model void!");
     }
-    std::ifstream infile(input);
+    std::ifstream infile(input, std::ios::in | std::ios::binary);
+    if(!infile.is_open())
+    {
+        cerr << "predict_all : Could not open input file!"
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Could not open input file!");
+    }
     std::ofstream outfile(output,std::ios::out);
     if(!outfile.is_open())
     {
@@ -284,88 +614,174 @@ void predict_all(const string& input, const string& output, std::shared_ptr<Line
         outfile << " " << labels[i];
     }
     outfile << "\n";
-    // initialize confusion matrix
-    std::vector<std::vector<size_t> > confusion_matrix(n_classes,std::vector<size_t>(n_classes));
-
-    // initialize iterator buffer to check if input label is valid
-    std::map<double,size_t>::iterator it = label_index.end();
-
-    // buffers for label and index
-    double true_label, pred_label;
-    size_t true_i,pred_i;
 
-    double n_correct = 0, n_samples = 0;
-
-    FeatureVector x;
-    size_t max_n_feature = 0;
-
-    // read through file
-    for(string line; std::getline(infile,line);)
+    const size_t chunk_size = 1 << 20;
+    const size_t n_scorers = resolve_n_threads(n_threads);
+    // a block is read, scored or being written in every slot
+    std::vector<PredictBlock> slots(2 * n_scorers + 2);
+    std::vector<PredictScorer> scorers(n_scorers);
+    for(size_t t = 0; t < n_scorers; ++t)
     {
-        std::stringstream ss(line);
-        string item;
-        std::getline(ss,item,' ');
-        true_label = std::stod(item);
-        it = label_index.find(true_label);
+        scorers[t].inner.reserve(4096 * estimate_n);
+        scorers[t].values.reserve(4096 * estimate_n);
+        scorers[t].confusion.assign(n_classes * n_classes, 0);
+    }
 
-        // if true label is not known to model
-        if(it == label_index.end())
-        {
-            cout << "Warning: Unexpected label(" << true_label
-                 << ") to model in file, will jump the line!";
-            // jump over
-            continue;
-        }
-        true_i = it->second;
+    std::mutex mutex;
+    std::condition_variable changed;
+    // number of blocks read and taken by scorers, all blocks are read
+    size_t n_read = 0, n_taken = 0;
+    bool eof = false;
+    std::exception_ptr error;
+    auto fail = [&]()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!error)
+            error = std::current_exception();
+        changed.notify_all();
+    };
 
-        // flush the feature buffer
-        max_n_feature = 0;
-        x.clear();
-        while(std::getline(ss,item,' '))
+    auto reader = [&]()
+    {
+        try
         {
-            int i;
-            float v_ij;
-            // sscanf(item.c_str(),"%d:%f",&i,&v_ij);
-            i = atoi(strtok(const_cast<char*>(item.c_str()),":") );
-            v_ij = atof(strtok(NULL,":" ));
-            max_n_feature++;
-            if(max_n_feature > estimate_n)
+            std::string text, rest;
+            size_t line = 1;
+            for(;;)
             {
-                estimate_n *= 2;
-                x.reserve(estimate_n);
+                text.swap(rest);
+                rest.clear();
+                const size_t size = text.size();
+                text.resize(size + chunk_size);
+                infile.read(&text[size], chunk_size);
+                text.resize(size + infile.gcount());
+                if(text.empty())
+                    break;
+                // the partial last line is moved to the next block
+                if(infile)
+                {
+                    size_t eol = text.rfind('\n');
+                    if(eol == std::string::npos)
+                    {
+                        rest.swap(text);
+                        continue;
+                    }
+                    rest.assign(text, eol + 1, std::string::npos);
+                    text.resize(eol + 1);
+                }
+                const size_t n_lines = std::count(text.begin(), text.end(), '\n');
+
+                std::unique_lock<std::mutex> lock(mutex);
+                PredictBlock& block = slots[n_read % slots.size()];
+                changed.wait(lock, [&]{ return block.state == PredictBlock::kEmpty || error; });
+                if(error)
+                    return;
+                block.text.swap(text);
+                block.first_line = line;
+                block.state = PredictBlock::kRead;
+                ++n_read;
+                changed.notify_all();
+                line += n_lines;
             }
-            x.push_back({(size_t) (i-1), v_ij});
         }
+        catch(...)
+        {
+            fail();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        eof = true;
+        changed.notify_all();
+    };
 
-        // TODO: add check if model is a probability model
-        if(flag_probability)
+    auto scorer = [&](size_t t)
+    {
+        try
         {
-            std::vector<double> p;
-            pred_label = lb->predict_proba(x,p);
-            outfile << pred_label;
-            for(size_t i = 0; i < n_classes;++i)
-                outfile << delim << p[i];
-            outfile << "\n";
+            for(;;)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]{ return n_taken < n_read || eof || error; });
+                if(error || n_taken == n_read)
+                    return;
+                PredictBlock& block = slots[n_taken++ % slots.size()];
+                lock.unlock();
+
+                predict_block(*lb, label_index, delim, flag_probability, block, scorers[t], hashing);
+
+                lock.lock();
+                block.state = PredictBlock::kScored;
+                changed.notify_all();
+            }
         }
-        else
+        catch(...)
         {
-            pred_label = lb->predict(x);
-            outfile << pred_label << "\n";
+            fail();
         }
+    };
 
-        // the labels is get from model, no safty problem
-        pred_i = label_index[pred_label];
+    std::vector<std::thread> workers;
+    workers.push_back(std::thread(reader));
+    for(size_t t = 0; t < n_scorers; ++t)
+        workers.push_back(std::thread(scorer, t));
 
-        // +1 for confusion matrix
-        ++confusion_matrix[pred_i][true_i];
-        // cout << "pred_i " << pred_i <<" true_i " << true_i << endl;
-        if(true_i == pred_i)
-            ++n_correct;
-        ++n_samples;
+    // write out the blocks in order
+    try
+    {
+        for(size_t b = 0; ; ++b)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            PredictBlock& block = slots[b % slots.size()];
+            changed.wait(lock, [&]
+            {
+                return block.state == PredictBlock::kScored || (eof && b == n_read) || error;
+            });
+            if(error || block.state != PredictBlock::kScored)
+                break;
+            lock.unlock();
+
+            cout << block.warnings;
+            outfile.write(block.output.data(), block.output.size());
+            if(!outfile)
+            {
+                cerr << "predict_all : Failed to write output file!"
+                     << __FILE__ << "," << __LINE__ << endl;
+                throw std::runtime_error("Failed to write output file!");
+            }
+
+            lock.lock();
+            block.state = PredictBlock::kEmpty;
+            changed.notify_all();
+        }
+    }
+    catch(...)
+    {
+        fail();
     }
+    for(size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+    if(error)
+        std::rethrow_exception(error);
     infile.close();
     outfile.close();
 
+    // merge the partial confusion matrices
+    std::vector<std::vector<size_t> > confusion_matrix(n_classes,std::vector<size_t>(n_classes));
+    double n_correct = 0, n_samples = 0;
+    for(size_t t = 0; t < n_scorers; ++t)
+    {
+        for(size_t pred_i = 0; pred_i < n_classes; ++pred_i)
+        {
+            for(size_t true_i = 0; true_i < n_classes; ++true_i)
+                confusion_matrix[pred_i][true_i] += scorers[t].confusion[pred_i * n_classes + true_i];
+        }
+    }
+    for(size_t pred_i = 0; pred_i < n_classes; ++pred_i)
+    {
+        for(size_t true_i = 0; true_i < n_classes; ++true_i)
+            n_samples += confusion_matrix[pred_i][true_i];
+        n_correct += confusion_matrix[pred_i][pred_i];
+    }
+
     double accuracy = (n_correct / n_samples) * 100;
     printf("Prediction Accuracy : %.4f%%\n",accuracy);
 
@@ -32,11 +32,30 @@
 #include <Eigen/Core>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
 namespace oplin{
 
+// Scalar type of feature values. Build with SINGLE_PRECISION=yes to store
+// features in float, which halves the memory of datasets. Weights,
+// gradients and losses are always double.
+#ifdef _OPLIN_FLOAT_
+typedef float FeatureScalar;
+#else
+typedef double FeatureScalar;
+#endif
+
+// Index type of features (both feature indices and column offsets). Build
+// with LARGE_INDEX=yes for datasets of more than 2^31 - 1 non-zeros.
+#ifdef _OPLIN_LARGE_INDEX_
+typedef int64_t FeatureIndex;
+#else
+typedef int FeatureIndex;
+#endif
+
 // Define Eigen vector and matrix types we will use
 typedef Eigen::SparseMatrix<double, Eigen::RowMajor> SpRowMatrix;
-typedef Eigen::SparseMatrix<double, Eigen::ColMajor> SpColMatrix;
+typedef Eigen::SparseMatrix<FeatureScalar, Eigen::ColMajor, FeatureIndex> SpColMatrix;
 typedef Eigen::SparseVector<double, Eigen::RowMajor> SpRowVector;
 typedef Eigen::SparseVector<double, Eigen::ColMajor> SpColVector;
 typedef Eigen::Matrix<double, Eigen::Dynamic, 1      , Eigen::ColMajor> ColVector;
@@ -44,8 +63,32 @@ typedef Eigen::Matrix<double, 1      , Eigen::Dynamic, Eigen::RowMajor> RowVecto
 typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrix;
 typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> ColMatrix;
 
+// read-only view on compressed column storage
+typedef Eigen::Map<const SpColMatrix> SpColMatrixMap;
+
+/// Compressed column storage without values, all non-zeros are 1
+struct SpColPattern
+{
+    size_t rows;
+    size_t cols;
+    std::vector<FeatureIndex> outer;
+    std::vector<FeatureIndex> inner;
+    SpColPattern(size_t r, size_t c, size_t nnz) : rows(r), cols(c), outer(c + 1, 0), inner(nnz){}
+};
+
+/// Values of the non-zeros of a compressed column storage, which are all
+/// ones if it stores no values (binary features)
+struct FeatureValues
+{
+    const FeatureScalar* data;
+    explicit FeatureValues(const FeatureScalar* values) : data(values){}
+    double operator[](size_t k) const { return data ? data[k] : 1.; }
+};
+
 // smart pointers
 typedef std::shared_ptr<SpColMatrix> SpColMatrixPtr;
+typedef std::shared_ptr<SpColPattern> SpColPatternPtr;
+typedef std::shared_ptr<SpColMatrixMap> SpColMatrixMapPtr;
 typedef std::shared_ptr<ColMatrix> ColMatrixPtr;
 typedef std::shared_ptr<ColVector> ColVectorPtr;
 
@@ -74,11 +117,51 @@ struct Dataset
     /**
      * features w.r.t order of y
      * dimension is dimension * n_samples
+     *
+     * X is a read-only view, the memory is held by storage which is
+     * either an owned SpColMatrix, an owned SpColPattern or a memory
+     * mapped binary dataset. X has no values (valuePtr() is NULL) if all
+     * the features are binary, see FeatureValues.
      */
-    SpColMatrixPtr X;
+    SpColMatrixMapPtr X;
+    /** owner of the memory viewed by X */
+    std::shared_ptr<const void> storage;
     double bias;
     Dataset() : bias(-1.){}
 
+    /**
+     * Take the ownership of a sparse matrix and let X view it
+     *
+     * @param mat features, dimension * n_samples
+     */
+    void set_X(SpColMatrixPtr mat)
+    {
+        mat->makeCompressed();
+        X = std::make_shared<SpColMatrixMap>(mat->rows(), mat->cols(), mat->nonZeros(),
+                                             mat->outerIndexPtr(), mat->innerIndexPtr(),
+                                             mat->valuePtr());
+        storage = mat;
+    }
+
+    /**
+     * Take the ownership of binary features and let X view them
+     *
+     * @param pattern non-zeros of features, dimension * n_samples
+     */
+    void set_X(SpColPatternPtr pattern)
+    {
+        X = std::make_shared<SpColMatrixMap>(pattern->rows, pattern->cols, pattern->inner.size(),
+                                             pattern->outer.data(), pattern->inner.data(),
+                                             (const FeatureScalar*)NULL);
+        storage = pattern;
+    }
+
+    /** true if X stores no values, every non-zero of X is 1 */
+    bool binary_features() const
+    {
+        return X && !X->valuePtr();
+    }
+
 };
 enum FormulaType
 {
@@ -86,12 +169,25 @@ enum FormulaType
     L2R_LR
 
 };
+enum MultiClassType
+{
+    OVR,
+    MULTINOMIAL
+};
 enum SolverType
 {
     GD,
     SGD,
     L_BFGS,
-    TRON
+    TRON,
+    FTRL_PROXIMAL
+};
+// storage of the weights of trained model, see Model::quantize
+enum WeightType
+{
+    WEIGHT_DOUBLE,
+    WEIGHT_INT8,
+    WEIGHT_FP16
 };
 
 /// Parameters for training
@@ -116,13 +212,52 @@ struct Parameter
     // std::vector<double> C;
     double base_C;
     std::vector<KeyValue<double,double> > adjust_C;
+    /** number of threads for training, 0 for all cores */
+    size_t n_threads;
+    /** strategy for more than 2 classes, see MultiClassType */
+    int multi_class;
+    /** storage of the weights of trained model, see WeightType */
+    int weight_type;
+    /**
+     * start from the weights of the trained model instead of 0, and keep
+     * the state of solvers (the L-BFGS curvature pairs) between trainings
+     */
+    bool warm_start;
 
-    Parameter() : solver_type(0.), problem_type(0.){}
+    Parameter() : solver_type(0.), problem_type(0.), n_threads(1), multi_class(OVR),
+                  weight_type(WEIGHT_DOUBLE), warm_start(false){}
 };
 typedef std::shared_ptr<Parameter> ParamPtr;
+
+/** default maximum epochs of LinearBase::partial_fit */
+const size_t kPartialFitEpochs = 10;
 typedef std::shared_ptr<Dataset> DatasetPtr;
 
 
+/** number of rows of weights sharing a scale of int8 model */
+const size_t kQuantBlock = 64;
+
+/**
+ * Convert IEEE half precision to float, in software as the build does
+ * not assume F16C. Exponent and mantissa are shifted in place, then the
+ * multiplication by 2^112 rebiases the exponent and normalizes subnormals.
+ */
+inline float half_to_float(uint16_t h)
+{
+    const uint32_t bits = (uint32_t)(h & 0x7fff) << 13;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    f *= 5.192296858534828e33f;
+    uint32_t scaled;
+    memcpy(&scaled, &f, sizeof(scaled));
+    // inf or nan, selected without branch to keep the loops vectorizable
+    scaled = bits >= 0x0f800000 ? bits | 0x7f800000 : scaled;
+    scaled |= (uint32_t)(h & 0x8000) << 16;
+    memcpy(&f, &scaled, sizeof(f));
+    return f;
+}
+uint16_t float_to_half(float);
+
 /// Model Parameters
 ///
 /// An important note here is the key part of model - weights:
@@ -150,11 +285,15 @@ struct Model
     double bias;
     /** labels of classes */
     std::vector<double> labels;
-    Model() : W_(NULL),bias_values_(NULL){}
+    /** true if the weights of classes are trained jointly by softmax */
+    bool multinomial;
+    Model() : multinomial(false),W_(NULL),bias_values_(NULL),index_(NULL),n_rows_(0),
+              weight_type_(WEIGHT_DOUBLE),quantized_(NULL),scales_(NULL){}
     // destructor must be called for double*
     ~Model()
     {
-        delete [] W_;
+        if(!storage_)
+            delete [] W_;
         delete [] bias_values_;
     }
     void set_bias_values(double* vals)
@@ -165,20 +304,163 @@ struct Model
     }
     void set_weights(double* w)
     {
-        if(W_)
+        set_weights(w, std::shared_ptr<const void>());
+    }
+    /**
+     * Let the weights view memory held by storage (e.g. a memory mapped
+     * model file), which is kept alive by the model and not deleted.
+     * An owned array is given with empty storage.
+     */
+    void set_weights(const double* w, std::shared_ptr<const void> storage)
+    {
+        if(W_ && !storage_)
             delete [] W_;
         W_ = w;
+        index_ = NULL;
+        n_rows_ = 0;
+        weight_type_ = WEIGHT_DOUBLE;
+        quantized_ = NULL;
+        scales_ = NULL;
+        storage_ = storage;
+    }
+    void set_sparse_weights(const uint64_t*, const double*, size_t, std::shared_ptr<const void>);
+    void set_sparse_weights(const std::vector<uint64_t>&, const std::vector<double>&);
+    void set_quantized_weights(int, const void*, const float*, std::shared_ptr<const void>);
+    bool compact();
+    bool quantize(int);
+    void dense_weights(double*) const;
+
+    /** weights of dense model, or the rows of sparse model, NULL if quantized */
+    const double* weights() const { return W_; }
+    /** see WeightType */
+    int weight_type() const { return weight_type_; }
+    /** true if the weights are stored in int8 or fp16 */
+    bool quantized() const { return weight_type_ != WEIGHT_DOUBLE; }
+    /** quantized rows of weights in the layout of weights() */
+    const void* quantized_weights() const { return quantized_; }
+    /** scale of every kQuantBlock rows of int8 model, NULL otherwise */
+    const float* scales() const { return scales_; }
+    /** bytes of a weight, see WeightType */
+    size_t weight_size() const
+    {
+        return weight_type_ == WEIGHT_INT8 ? 1 : weight_type_ == WEIGHT_FP16 ? 2 : sizeof(double);
+    }
+    /** number of rows of weights, n_rows() for sparse model else dimension */
+    size_t n_weight_rows() const { return index_ ? n_rows_ : dimension; }
+    /** number of scales of int8 model */
+    size_t n_scales() const
+    {
+        return weight_type_ == WEIGHT_INT8 ? (n_weight_rows() + kQuantBlock - 1) / kQuantBlock : 0;
     }
+    /**
+     * Weight c of a row of weights, dequantized
+     *
+     * @param row  row of weights, a feature of dense model
+     * @param c    class, less than n_ws
+     * @param n_ws weights per row
+     */
+    double row_weight(size_t row, size_t c, size_t n_ws) const
+    {
+        switch(weight_type_)
+        {
+        case WEIGHT_INT8:
+            return (double)scales_[row / kQuantBlock] * static_cast<const int8_t*>(quantized_)[row * n_ws + c];
+        case WEIGHT_FP16:
+            return half_to_float(static_cast<const uint16_t*>(quantized_)[row * n_ws + c]);
+        default:
+            return W_[row * n_ws + c];
+        }
+    }
+    /** true if only the features of non-zero weights are stored */
+    bool sparse() const { return index_ != NULL; }
+    /** index of sparse model, see add_weights */
+    const uint64_t* sparse_index() const { return index_; }
+    /** number of features of non-zero weights of sparse model */
+    size_t n_rows() const { return n_rows_; }
+    /** number of uint64_t of index of sparse model */
+    size_t index_size() const { return 2 * ((dimension + 63) / 64); }
 // I encapsulate the two pointers to avoid wrong reference in productive env.
 private:
-    double* W_;
+    /**
+     * Add v times the n_ws weights of feature to scores, for any layout of
+     * weights: dense or sparse (the row is the rank of feature, nothing is
+     * added if the feature is not stored), double or quantized (the
+     * weights are dequantized on the fly).
+     */
+    void add_weights(uint64_t feature, double v, double* scores, size_t n_ws) const
+    {
+        uint64_t row = feature;
+        if(index_)
+        {
+            const uint64_t* block = index_ + 2 * (feature >> 6);
+            const uint64_t bit = (uint64_t)1 << (feature & 63);
+            if(!(block[0] & bit))
+                return;
+            row = block[1] + __builtin_popcountll(block[0] & (bit - 1));
+        }
+        switch(weight_type_)
+        {
+        case WEIGHT_INT8:
+        {
+            const int8_t* w = static_cast<const int8_t*>(quantized_) + row * n_ws;
+            const double scaled_v = v * scales_[row / kQuantBlock];
+            for(size_t c = 0; c < n_ws; ++c)
+                scores[c] += scaled_v * w[c];
+            break;
+        }
+        case WEIGHT_FP16:
+        {
+            // half_to_float with its multiplication by 2^112 moved out of
+            // the loop, fp16 weights are finite (see float_to_half)
+            const uint16_t* w = static_cast<const uint16_t*>(quantized_) + row * n_ws;
+            const double scaled_v = v * 5.192296858534828e33;
+            for(size_t c = 0; c < n_ws; ++c)
+            {
+                const uint32_t bits = ((uint32_t)(w[c] & 0x7fff) << 13) | ((uint32_t)(w[c] & 0x8000) << 16);
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                scores[c] += scaled_v * f;
+            }
+            break;
+        }
+        default:
+        {
+            const double* w = W_ + row * n_ws;
+            for(size_t c = 0; c < n_ws; ++c)
+                scores[c] += v * w[c];
+        }
+        }
+    }
+
+    const double* W_;
     double* bias_values_;
+    /**
+     * Sparse model stores the rows of weights of non-zero features only,
+     * in the order of features. Every 64 features j in [64b, 64b + 64)
+     * have a bitmap index_[2b] whose bit j % 64 is set if j is stored,
+     * and index_[2b+1], the number of stored features before 64b, so the
+     * row of j is found by the rank of j. index_ is NULL for dense model.
+     */
+    const uint64_t* index_;
+    size_t n_rows_;
+    /**
+     * Quantized model stores the rows in int8 or fp16 in quantized_
+     * instead of W_, which is NULL. Every kQuantBlock rows of int8 share
+     * the scale scales_[row / kQuantBlock], the weight is the int8 times
+     * the scale.
+     */
+    int weight_type_;
+    const void* quantized_;
+    const float* scales_;
+    /** owner of the memory of W_ if it is not owned by the model */
+    std::shared_ptr<const void> storage_;
     /** weights */
 
     friend class LinearBase;
 };
 
-typedef std::vector<KeyValue<size_t,double> > FeatureVector;
+typedef KeyValue<size_t,double> FeatureNode;
+typedef std::vector<FeatureNode> FeatureVector;
 // symbolic links for short implementation views
 // typedef std::shared_ptr<Model> ModelPtr;
 
@@ -197,9 +479,10 @@ protected:
     // model instance
     ModelUniPtr model_;
     bool trained_;
-    void predict_WTx(const FeatureVector, std::vector<double>&);
-    void preprocess_data(const DatasetPtr, std::vector<size_t>&,
-                         std::vector<size_t>&, std::vector<size_t>&);
+    // parameters of the last training, reused by partial_fit
+    ParamPtr param_;
+    void predict_WTx(const FeatureNode*, size_t, double*) const;
+    void preprocess_data(const DatasetPtr, std::vector<size_t>&, std::vector<size_t>&);
 public:
 
     LinearBase(void);
@@ -211,10 +494,15 @@ public:
     virtual std::vector<double> get_labels();
     virtual void load_model(ModelUniPtr);
     virtual ModelUniPtr export_model();
-    virtual void export_model_to_file(const std::string&);
+    virtual void export_model_to_file(const std::string&, bool binary = false);
     virtual void train(const DatasetPtr, const ParamPtr) = 0;
-    virtual double predict(const FeatureVector);
-    virtual double predict_proba(const FeatureVector, std::vector<double>&);
+    virtual void partial_fit(const DatasetPtr, const ParamPtr = ParamPtr(),
+                             size_t max_epoch = kPartialFitEpochs);
+    virtual double predict(const FeatureVector&);
+    virtual double predict(const FeatureNode*, size_t, double*);
+    virtual double predict_proba(const FeatureVector&, std::vector<double>&);
+    virtual double predict_proba(const FeatureNode*, size_t, double*);
+    virtual void predict_batch(const SpColMatrixMap&, double*, double* probability = NULL);
 };
 
 } // oplin
@@ -15,12 +15,23 @@ namespace oplin{
 class LogisticRegression : public LinearBase
 {
 private:
-void train_ovr(DatasetPtr , ParamPtr , const std::vector<double>&, Eigen::Ref<ColVector>);
+// solvers of the last training kept for warm start, of every class of
+// One-vs-Rest or the only one of binary and multinomial problems
+std::vector<std::shared_ptr<SolverBase> > solvers_;
+bool warm_start(DatasetPtr, ParamPtr, bool, double*);
+void train_classes(DatasetPtr, DatasetStreamPtr, ParamPtr);
+void train_ovr(DatasetPtr , ParamPtr , const std::vector<double>&, Eigen::Ref<ColVector>,
+               std::shared_ptr<SolverBase>&, DatasetStreamPtr = DatasetStreamPtr());
+void train_multinomial(DatasetPtr , ParamPtr , const std::vector<double>&, Eigen::Ref<ColVector>,
+                       std::shared_ptr<SolverBase>&);
+void train_ftrl(DatasetPtr, DatasetStreamPtr, ParamPtr, const std::vector<size_t>&,
+                const std::vector<double>&, double*);
 public:
     LogisticRegression() : LinearBase(){};
     explicit LogisticRegression(ModelUniPtr model) : LinearBase(std::move(model)){};
     ~LogisticRegression(void) {};
     void train(const DatasetPtr, const ParamPtr);
+    void train(const DatasetStreamPtr, const ParamPtr);
 };
 
 } // namespace oplin
@@ -0,0 +1,43 @@
+// Read-only memory mapped file
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_MAPPED_FILE_H_
+#define OPENLINEAR_MAPPED_FILE_H_
+
+#include <string>
+#include <memory>
+
+namespace oplin{
+
+/// Thin RAII wrapper of mmap(2).
+///
+/// The whole file is mapped read-only at construction and released at
+/// destruction, so the pointer returned by data() is valid during the
+/// life time of the instance. Copy is forbidden to avoid double munmap.
+///
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string&);
+    ~MappedFile();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    void advise(int) const;
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const char* data_;
+    size_t size_;
+};
+typedef std::shared_ptr<MappedFile> MappedFilePtr;
+
+} // oplin
+
+#endif// OPENLINEAR_MAPPED_FILE_H_
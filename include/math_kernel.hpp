@@ -0,0 +1,57 @@
+// Batched math kernels of logistic loss and sigmoid
+//
+// The per-sample terms of logistic regression are evaluated over
+// contiguous arrays with SIMD instructions. The instruction set (AVX-512,
+// AVX2 or scalar) is chosen at runtime by cpu features, the vectorized
+// versions are compiled in separated translation units with their own
+// instruction set flags.
+//
+// All kernels are numerically stable for any margin m = y * z:
+//
+//     log(1 + exp(-m)) = max(-m, 0) + log1p(exp(-|m|))
+//     sigmoid(m) - 1   = -exp(-|m|) / (1 + exp(-|m|))   if m >= 0
+//                      = -1 / (1 + exp(-|m|))           otherwise
+//
+// so only exp(-|m|), which never overflows, is evaluated.
+//
+// This header is kept free of Eigen on purpose, see math_kernel.cpp.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_MATH_KERNEL_H_
+#define OPENLINEAR_MATH_KERNEL_H_
+
+#include <stddef.h>
+
+namespace oplin{
+
+enum SimdType
+{
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+SimdType detect_simd_type();
+SimdType get_simd_type();
+void set_simd_type(SimdType);
+const char* simd_type_name(SimdType);
+
+double logistic_loss(const double*, const double*, const double*, size_t);
+double logistic_loss_grad(const double*, const double*, const double*, double*, size_t);
+void sigmoid(const double*, double*, size_t);
+
+// instruction set specific versions, use the dispatched ones above
+double logistic_loss_scalar(const double*, const double*, const double*, double*, size_t);
+double logistic_loss_avx2(const double*, const double*, const double*, double*, size_t);
+double logistic_loss_avx512(const double*, const double*, const double*, double*, size_t);
+void sigmoid_scalar(const double*, double*, size_t);
+void sigmoid_avx2(const double*, double*, size_t);
+void sigmoid_avx512(const double*, double*, size_t);
+
+} // oplin
+
+#endif// OPENLINEAR_MATH_KERNEL_H_
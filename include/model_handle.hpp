@@ -0,0 +1,96 @@
+// Model handle for concurrent serving
+//
+// A serving process predicts on many threads and replaces its model by a
+// retrained one from time to time. ModelHandle holds the current model
+// in read-copy-update manner: a predicting thread pins the current model
+// for the duration of a prediction without taking any lock, and a
+// publisher installs a new model with one atomic exchange. The former
+// model is deleted by the publisher once all the threads which might
+// still read it have unpinned it, so readers never wait for publishers.
+//
+// Usage:
+//
+//     ModelHandle handle(std::unique_ptr<LinearBase>(new LogisticRegression(read_model(file))));
+//     // on predicting threads
+//     {
+//         ModelHandle::Snapshot model = handle.pin();
+//         label = model->predict(x);
+//     }
+//     // on publishing thread
+//     handle.publish(std::unique_ptr<LinearBase>(new LogisticRegression(read_model(file))));
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_MODEL_HANDLE_H_
+#define OPENLINEAR_MODEL_HANDLE_H_
+
+#include <atomic>
+#include <mutex>
+#include "linear.hpp"
+
+namespace oplin{
+
+/// Current model shared by predicting threads and replaced by publishers
+///
+/// Every pinned snapshot occupies a reader slot, which records the epoch
+/// of publishing when it was pinned. A publisher bumps the epoch after
+/// installing a new model, and waits for the slots of earlier epochs
+/// before deleting the former model. At most kMaxReaders snapshots can be
+/// pinned at the same time, further pins spin until a slot is free.
+///
+class ModelHandle
+{
+public:
+    static const size_t kMaxReaders = 256;
+
+    /// Model pinned for predicting, it is not deleted until unpinned by
+    /// the destruction of the snapshot. A snapshot should be short lived
+    /// (e.g. one prediction or one batch) as it holds back publishers.
+    class Snapshot
+    {
+    public:
+        Snapshot(Snapshot&&);
+        ~Snapshot();
+        LinearBase* operator->() const { return model_; }
+        LinearBase& operator*() const { return *model_; }
+    private:
+        Snapshot(std::atomic<uint64_t>*, LinearBase*);
+        Snapshot(const Snapshot&);
+        Snapshot& operator=(const Snapshot&);
+
+        std::atomic<uint64_t>* slot_;
+        LinearBase* model_;
+        friend class ModelHandle;
+    };
+
+    explicit ModelHandle(std::unique_ptr<LinearBase>);
+    ~ModelHandle();
+
+    Snapshot pin();
+    void publish(std::unique_ptr<LinearBase>);
+
+private:
+    ModelHandle(const ModelHandle&);
+    ModelHandle& operator=(const ModelHandle&);
+
+    /// Epoch of a pinned snapshot, 0 if the slot is free. Padded to a
+    /// cache line so that readers do not share lines.
+    struct ReaderSlot
+    {
+        std::atomic<uint64_t> epoch;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    std::atomic<LinearBase*> current_;
+    std::atomic<uint64_t> epoch_;
+    ReaderSlot slots_[kMaxReaders];
+    /** publishers are serialized */
+    std::mutex publish_mutex_;
+};
+
+} // oplin
+
+#endif// OPENLINEAR_MODEL_HANDLE_H_
@@ -0,0 +1,119 @@
+// Helpers for data parallel loops
+//
+// Threads are created for each loop instead of being kept in a pool,
+// which keeps the helpers free of shared state and safe to be nested.
+// The loops are expected to be heavy enough (a pass over dataset) to
+// hide the cost of thread creation.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_PARALLEL_H_
+#define OPENLINEAR_PARALLEL_H_
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+
+namespace oplin{
+
+size_t resolve_n_threads(size_t);
+void partition_evenly(size_t, size_t, std::vector<size_t>&);
+
+/**
+ * Partition columns of compressed storage into ranges of about the same
+ * number of non-zeros.
+ *
+ * @param outer   outer index array of n_cols + 1 entries
+ * @param n_cols  number of columns
+ * @param n_parts number of ranges
+ * @param bounds  n_parts + 1 bounds, range t is [bounds[t], bounds[t+1])
+ */
+template <class StorageIndex>
+void partition_by_nnz(const StorageIndex* outer, size_t n_cols, size_t n_parts,
+                      std::vector<size_t>& bounds)
+{
+    const double nnz = outer[n_cols] - outer[0];
+    bounds.assign(1, 0);
+    for(size_t t = 1; t < n_parts; ++t)
+    {
+        const StorageIndex target = outer[0] + (StorageIndex)(nnz * t / n_parts);
+        size_t j = std::lower_bound(outer, outer + n_cols + 1, target) - outer;
+        bounds.push_back(std::min(std::max(j, bounds.back()), n_cols));
+    }
+    bounds.push_back(n_cols);
+}
+
+/**
+ * Run fn(t, bounds[t], bounds[t+1]) for every range t concurrently, the
+ * first range is run by the calling thread.
+ *
+ * @param bounds range bounds, see partition_evenly and partition_by_nnz
+ * @param fn     function of (thread index, begin, end)
+ */
+template <class Function>
+void parallel_for(const std::vector<size_t>& bounds, Function fn)
+{
+    const size_t n_parts = bounds.size() - 1;
+    std::vector<std::thread> workers;
+    workers.reserve(n_parts - 1);
+    for(size_t t = 1; t < n_parts; ++t)
+        workers.push_back(std::thread(fn, t, bounds[t], bounds[t+1]));
+    fn(0, bounds[0], bounds[1]);
+    for(size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+}
+
+/**
+ * Run fn(task) for tasks 0, 1, ..., n_tasks - 1 on n_threads threads
+ * (the calling thread included), each thread takes the next task once it
+ * finishes one. The first exception thrown by a task stops taking new
+ * tasks, and is rethrown by the calling thread after all threads finish.
+ *
+ * @param n_tasks   number of tasks
+ * @param n_threads number of threads
+ * @param fn        function of (task index)
+ */
+template <class Function>
+void parallel_tasks(size_t n_tasks, size_t n_threads, Function fn)
+{
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]()
+    {
+        for(size_t task = next++; task < n_tasks; task = next++)
+        {
+            try
+            {
+                fn(task);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if(!error)
+                    error = std::current_exception();
+                next = n_tasks;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    n_threads = std::max<size_t>(std::min(n_threads, n_tasks), 1);
+    workers.reserve(n_threads - 1);
+    for(size_t t = 1; t < n_threads; ++t)
+        workers.push_back(std::thread(worker));
+    worker();
+    for(size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+    if(error)
+        std::rethrow_exception(error);
+}
+
+} // oplin
+
+#endif// OPENLINEAR_PARALLEL_H_
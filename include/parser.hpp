@@ -0,0 +1,77 @@
+// Fast libsvm format parser
+//
+// The input file is memory mapped and cut into newline-aligned chunks,
+// which are parsed concurrently. Numbers are scanned in place by hand
+// written routines so that no temporary string or stream is created
+// per line or per token.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_PARSER_H_
+#define OPENLINEAR_PARSER_H_
+
+#include <set>
+#include "linear.hpp"
+
+namespace oplin{
+
+/// Parsed content of one newline-aligned chunk of libsvm text
+struct ParsedChunk
+{
+    /** number of samples parsed */
+    size_t n_samples;
+    /** maximum feature index (1-based) seen */
+    size_t n_features;
+    /** targets */
+    std::vector<double> y;
+    /** distinct targets */
+    std::set<double> classes;
+    /**
+     * compressed columns of the samples: column j holds the entries
+     * [outer[j], outer[j+1]) of inner and values, sorted by inner index
+     */
+    std::vector<size_t> outer;
+    /** feature index - 1 */
+    std::vector<int> inner;
+    std::vector<FeatureScalar> values;
+    /** empty if the chunk is parsed successfully */
+    std::string error;
+    ParsedChunk() : n_samples(0), n_features(0), outer(1, 0){}
+};
+
+/// Feature hashing settings, see hash_feature
+struct FeatureHashing
+{
+    /** features are hashed into 2^bits, 0 if hashing is disabled */
+    int bits;
+    /**
+     * true to flip the sign of value by another bit of hash, so that the
+     * colliding features cancel out in expectation
+     */
+    bool signed_hash;
+    FeatureHashing(int b = 0, bool s = false) : bits(b), signed_hash(s){}
+    bool enabled() const { return bits > 0; }
+    /** number of hashed features */
+    size_t dimension() const { return (size_t)1 << bits; }
+};
+
+/** largest bits of feature hashing, the features fit FeatureIndex */
+const int kMaxHashBits = 30;
+
+uint32_t murmur_hash3(const char*, size_t, uint32_t);
+void check_hashing(const FeatureHashing&);
+const char* scan_double(const char*, const char*, double&);
+const char* scan_index(const char*, const char*, long&);
+const char* scan_hashed_feature(const char*, const char*, const FeatureHashing&, size_t&, double&);
+void split_chunks(const char*, size_t, size_t, std::vector<size_t>&);
+void parse_libsvm_chunk(const char*, const char*, ParsedChunk&,
+                        const FeatureHashing& hashing = FeatureHashing());
+void parse_libsvm(const char*, size_t, size_t, std::vector<ParsedChunk>&,
+                  const FeatureHashing& hashing = FeatureHashing());
+
+} // oplin
+
+#endif// OPENLINEAR_PARSER_H_
@@ -37,7 +37,10 @@ protected:
     ColVector steepest_grad_;
     /** column vector to store steepest gradient at iteration k */
     ColVector grad_;
-    /** column vector to store steepest gradient at iteration k+1 */
+    /**
+     * column vector to store steepest gradient at iteration k+1, it is
+     * computed by line search together with the loss at accepted step
+     */
     ColVector next_grad_;
     /** column vector to store steepest gradient at iteration k+1 */
     ColVector next_w_;
@@ -63,10 +66,28 @@ public:
 };
 
 /// Stochastic gradient descent optimizer
+///
+/// Samples are visited in random order and split among threads, which
+/// update the shared weights without any lock (Hogwild!). Regularization
+/// is applied lazily, a feature catches up the decay (L2) or truncation
+/// (L1) of the steps it missed only when a sample touches it.
+///
+/// Reference:
+/// Feng Niu, Benjamin Recht, Christopher Re and Stephen J. Wright.
+/// Hogwild!: A lock-free approach to parallelizing stochastic gradient
+/// descent. In NIPS, 2011.
+///
 class StochasticGD: public SolverBase
 {
 public:
     ~StochasticGD();
+    void solve(ProblemPtr, ParamPtr, Eigen::Ref<ColVector>&);
+
+private:
+    /** sample order of current epoch */
+    std::vector<size_t> order_;
+    /** step of the last regularization of every feature */
+    std::vector<size_t> last_step_;
 };
 
 class LBFGS: public SolverBase
@@ -76,13 +97,15 @@ public:
     LBFGS(const size_t);
     ~LBFGS();
     void solve(ProblemPtr, ParamPtr, Eigen::Ref<ColVector>&);
+    const std::deque<ColVectorPtr>& get_s_list() const;
+    const std::deque<ColVectorPtr>& get_y_list() const;
 
 private:
 
     void two_loop(ProblemPtr, const Eigen::Ref<const ColVector>&);
     void search_direction(ProblemPtr, ParamPtr, const Eigen::Ref<const ColVector>&);
     void update(ProblemPtr, ParamPtr, const Eigen::Ref<const ColVector>&);
-
+    void resize_history(size_t);
 
     /** m steps to keep */
     size_t m_step_;
@@ -103,7 +126,22 @@ private:
 class TRON: public SolverBase
 {
 public:
+    TRON();
     ~TRON();
+    void solve(ProblemPtr, ParamPtr, Eigen::Ref<ColVector>&);
+
+private:
+
+    size_t trust_region_cg(ProblemPtr, const Eigen::Ref<const ColVector>&, const double&);
+
+    /** residual of conjugate gradient */
+    ColVector r_;
+    /** conjugate direction */
+    ColVector d_;
+    /** Hessian-vector product of conjugate direction */
+    ColVector Hd_;
+    /** maximum conjugate gradient iterations per epoch */
+    size_t max_cg_iter_;
 };
 
 } // oplin
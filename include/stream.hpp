@@ -0,0 +1,74 @@
+// Out-of-core dataset streamed from binary dataset shards
+//
+// A dataset larger than memory is split into libsvm shards, each of which
+// is converted to a binary dataset file (see binary_io.hpp) on its own.
+// Only the targets of all samples are kept in memory, the features are
+// read block by block of samples at every pass, and the next block is
+// read by a prefetch thread while the current one is computed.
+//
+// The shards are concatenated in the given order. The dimension is the
+// largest of the shards, and if the shards were converted with a bias
+// term, the bias feature of every shard is moved to the last feature.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_STREAM_H_
+#define OPENLINEAR_STREAM_H_
+
+#include <functional>
+#include "binary_io.hpp"
+
+namespace oplin{
+
+/// Features of a block of consecutive samples
+struct DatasetBlock
+{
+    /** index of the first sample in the whole dataset */
+    size_t begin;
+    /** number of samples */
+    size_t n_samples;
+    /** compressed columns of samples, outer starts from 0 */
+    std::vector<FeatureIndex> outer;
+    std::vector<FeatureIndex> inner;
+    /** empty for binary features, see FeatureValues */
+    std::vector<FeatureScalar> values;
+    DatasetBlock() : begin(0), n_samples(0){}
+};
+
+/// Dataset read from binary dataset shards by blocks of samples
+///
+class DatasetStream
+{
+public:
+    DatasetStream(const std::vector<std::string>&, size_t);
+    ~DatasetStream();
+
+    DatasetPtr dataset() const;
+    size_t nnz() const { return nnz_; }
+    void for_each_block(std::function<void(const DatasetBlock&)>);
+
+private:
+    DatasetStream(const DatasetStream&);
+    DatasetStream& operator=(const DatasetStream&);
+
+    void read_block(size_t, size_t, size_t, DatasetBlock&) const;
+
+    /** file descriptors and headers of shards */
+    std::vector<int> fds_;
+    std::vector<DatasetFileHeader> headers_;
+    /** index of the first sample of every shard */
+    std::vector<size_t> shard_begin_;
+    /** number of samples per block */
+    size_t block_size_;
+    size_t nnz_;
+    /** targets and labels of all samples, X is NULL */
+    DatasetPtr dataset_;
+};
+typedef std::shared_ptr<DatasetStream> DatasetStreamPtr;
+
+} // oplin
+
+#endif// OPENLINEAR_STREAM_H_
@@ -0,0 +1,71 @@
+// Benchmark of FTRL-Proximal online learning on a synthetic sparse
+// dataset: the throughput in samples per second of one core, the mean
+// progressive validation loss (of every sample before learning it), and
+// the non-zero features of the exported model, with L1 and with L2
+// regularization
+//
+// Usage: bench_ftrl [n_samples] [dimension] [nnz_per_sample] [alpha] [C]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include "ftrl.hpp"
+#include "synthetic_dataset.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+int main(int argc, char **argv)
+{
+    const size_t n_samples = argc > 1 ? atoi(argv[1]) : 1000000;
+    const size_t dimension = argc > 2 ? atoi(argv[2]) : 1000000;
+    const size_t nnz_per_sample = argc > 3 ? atoi(argv[3]) : 30;
+    const double alpha = argc > 4 ? atof(argv[4]) : 0.1;
+    const double C = argc > 5 ? atof(argv[5]) : 1;
+
+    oplin::DatasetPtr dataset = synthetic_dataset(n_samples, dimension, nnz_per_sample);
+    const oplin::SpColMatrixMap& X = *(dataset->X);
+    std::vector<size_t> classes(n_samples);
+    for(size_t i = 0; i < n_samples; ++i)
+        classes[i] = dataset->y[i] == dataset->labels[0] ? 0 : 1;
+    const std::vector<double> penalty(n_samples, C);
+
+    // the same samples one at a time through the per sample API
+    std::vector<oplin::FeatureVector> samples(n_samples);
+    for(size_t i = 0; i < n_samples; ++i)
+    {
+        for(auto k = X.outerIndexPtr()[i]; k < X.outerIndexPtr()[i+1]; ++k)
+            samples[i].push_back({(size_t)X.innerIndexPtr()[k], X.valuePtr()[k]});
+    }
+
+    printf("n_samples : %zu, dimension : %zu, nnz : %ld, alpha : %g, C : %g\n", n_samples,
+           dimension, (long)X.nonZeros(), alpha, C);
+    printf("|%6s|%14s|%14s|%12s|%14s|\n", "reg", "api", "samples/s", "mean loss", "non-zeros");
+    const char* names[] = {"L1", "L2"};
+    for(size_t r = 0; r < 2; ++r)
+    {
+        for(size_t api = 0; api < 2; ++api)
+        {
+            oplin::FTRLProximal ftrl(dimension, dataset->labels, alpha, 1, r == 0 ? 1 : 0, r == 0 ? 0 : 1);
+            Clock::time_point start = Clock::now();
+            if(api == 0)
+                ftrl.learn(X, classes.data(), penalty.data());
+            else
+            {
+                for(size_t i = 0; i < n_samples; ++i)
+                    ftrl.learn(samples[i].data(), samples[i].size(), dataset->y[i], C);
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            oplin::ModelUniPtr model = ftrl.export_model();
+            const size_t non_zeros = model->sparse() ? model->n_rows() :
+                std::count_if(model->weights(), model->weights() + dimension,
+                              [](double w){ return w != 0; });
+            printf("|%6s|%14s|%14.0f|%12.6f|%14zu|\n", names[r], api == 0 ? "columns" : "FeatureNode",
+                   n_samples / seconds, ftrl.mean_loss(), non_zeros);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
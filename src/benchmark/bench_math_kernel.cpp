@@ -0,0 +1,94 @@
+// Benchmark of the batched logistic loss kernels against plain loops of
+// log(1 + exp(-y z)) and 1 / (1 + exp(-y z)) for every instruction set
+// supported by the cpu
+//
+// Usage: bench_math_kernel [max_n_samples]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include "math_kernel.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point& start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * Loss and gradient coefficients as computed per sample before
+ */
+static double plain_loss_grad(const std::vector<double>& z, const std::vector<double>& y,
+                              const std::vector<double>& C, std::vector<double>& d, size_t n)
+{
+    double f = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        f += C[i] * log(1 + exp(-y[i] * z[i]));
+        d[i] = C[i] * (1 / (1 + exp(-y[i] * z[i])) - 1) * y[i];
+    }
+    return f;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t max_n = argc > 1 ? atol(argv[1]) : 100000000;
+    const size_t n_repeats = 3;
+
+    std::mt19937 gen(0);
+    std::normal_distribution<double> margin(0, 5);
+    std::vector<double> z(max_n), y(max_n), C(max_n, 1), d(max_n), d_ref(max_n);
+    for(size_t i = 0; i < max_n; ++i)
+    {
+        z[i] = margin(gen);
+        y[i] = gen() & 1 ? 1 : -1;
+    }
+
+    const oplin::SimdType best = oplin::detect_simd_type();
+    printf("|%10s|%8s|%10s|%10s|%8s|%10s|\n", "n_samples", "simd", "plain(ms)", "kernel(ms)",
+           "speedup", "rel_err");
+    for(size_t n = 1000000; n <= max_n; n *= 10)
+    {
+        double t_plain = 0;
+        for(size_t r = 0; r < n_repeats; ++r)
+        {
+            Clock::time_point start = Clock::now();
+            plain_loss_grad(z, y, C, d, n);
+            t_plain += seconds_since(start);
+        }
+        // the plain loop loses precision of small coefficients by
+        // cancellation, errors are measured against the scalar kernel
+        double f_ref = oplin::logistic_loss_scalar(z.data(), y.data(), C.data(), d_ref.data(), n);
+        for(int type = oplin::SIMD_SCALAR; type <= best; ++type)
+        {
+            oplin::set_simd_type(static_cast<oplin::SimdType>(type));
+            double t_kernel = 0, f = 0;
+            for(size_t r = 0; r < n_repeats; ++r)
+            {
+                Clock::time_point start = Clock::now();
+                f = oplin::logistic_loss_grad(z.data(), y.data(), C.data(), d.data(), n);
+                t_kernel += seconds_since(start);
+            }
+            // worst relative error
+            double err = 0;
+            for(size_t i = 0; i < n; ++i)
+                err = std::max(err, std::fabs(d[i] - d_ref[i]) / std::max(std::fabs(d_ref[i]), 1e-300));
+            err = std::max(err, std::fabs(f - f_ref) / f_ref);
+            printf("|%10zu|%8s|%10.2f|%10.2f|%8.2f|%10.2e|\n", n,
+                   oplin::simd_type_name(static_cast<oplin::SimdType>(type)),
+                   t_plain * 1000 / n_repeats, t_kernel * 1000 / n_repeats, t_plain / t_kernel, err);
+        }
+    }
+    oplin::set_simd_type(best);
+
+    return EXIT_SUCCESS;
+}
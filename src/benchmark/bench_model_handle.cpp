@@ -0,0 +1,144 @@
+// Stress benchmark of ModelHandle: predicting threads run at full rate
+// while a publisher reloads the model from a binary model file again and
+// again. The latency percentiles of predictions are printed without and
+// with publishing, and with a mutex guarding the model instead of the
+// handle for comparison.
+//
+// Usage: bench_model_handle [n_readers] [seconds] [publish_interval_ms] [dimension]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <random>
+#include <thread>
+#include "logistic.hpp"
+#include "model_handle.hpp"
+#include "high_level_function.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+enum Mode { kHandle, kHandlePublish, kMutexPublish };
+
+/**
+ * Run the readers for seconds and print the latency percentiles
+ */
+static void run(const char* name, Mode mode, size_t n_readers, double seconds, size_t interval_ms,
+                const std::string& model_file, const std::vector<oplin::FeatureVector>& samples)
+{
+    auto load = [&]()
+    {
+        return std::unique_ptr<oplin::LinearBase>(
+            new oplin::LogisticRegression(oplin::read_model(model_file)));
+    };
+    oplin::ModelHandle handle(load());
+    std::unique_ptr<oplin::LinearBase> guarded = load();
+    std::mutex mutex;
+    std::atomic<bool> stop(false);
+    size_t n_published = 0;
+
+    std::vector<std::vector<double> > latencies(n_readers);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < n_readers; ++t)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            std::vector<double> scores(2);
+            std::vector<double>& latency = latencies[t];
+            latency.reserve(1 << 22);
+            double sum = 0;
+            for(size_t i = t; !stop; i = (i + 1) % samples.size())
+            {
+                const oplin::FeatureVector& x = samples[i];
+                Clock::time_point start = Clock::now();
+                if(mode == kMutexPublish)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    sum += guarded->predict(x.data(), x.size(), scores.data());
+                }
+                else
+                {
+                    oplin::ModelHandle::Snapshot model = handle.pin();
+                    sum += model->predict(x.data(), x.size(), scores.data());
+                }
+                latency.push_back(std::chrono::duration<double>(Clock::now() - start).count() * 1e9);
+            }
+            if(sum == 0.5)
+                printf("\n");
+        }));
+    }
+
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(seconds));
+    while(Clock::now() < end)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        if(mode == kHandle)
+            continue;
+        // the new model is loaded before taking the model away from readers
+        std::unique_ptr<oplin::LinearBase> model = load();
+        if(mode == kHandlePublish)
+            handle.publish(std::move(model));
+        else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            guarded = std::move(model);
+        }
+        ++n_published;
+    }
+    stop = true;
+    for(size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    std::vector<double> all;
+    for(size_t t = 0; t < n_readers; ++t)
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+    printf("|%16s|%10zu|%12.2f|%9.0f|%9.0f|%9.0f|%10.0f|\n", name, n_published, all.size() / seconds / 1e6,
+           percentile(0.5), percentile(0.99), percentile(0.999), all.back());
+}
+
+int main(int argc, char **argv)
+{
+    const size_t n_readers = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    const double seconds = argc > 2 ? atof(argv[2]) : 2;
+    const size_t interval_ms = argc > 3 ? atoi(argv[3]) : 1;
+    const size_t dimension = argc > 4 ? atoi(argv[4]) : 1000000;
+    const std::string model_file = "/tmp/bench_model_handle.model";
+
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<size_t> feature(0, dimension - 1);
+    std::uniform_real_distribution<double> value(-1, 1);
+    oplin::ModelUniPtr model(new oplin::Model());
+    model->n_classes = 2;
+    model->dimension = dimension;
+    model->bias = -1;
+    model->labels.push_back(1);
+    model->labels.push_back(-1);
+    double* W = new double[dimension];
+    for(size_t j = 0; j < dimension; ++j)
+        W[j] = value(gen);
+    model->set_weights(W);
+    oplin::LogisticRegression(std::move(model)).export_model_to_file(model_file, true);
+
+    std::vector<oplin::FeatureVector> samples(100000);
+    for(size_t i = 0; i < samples.size(); ++i)
+    {
+        for(size_t k = 0; k < 30; ++k)
+            samples[i].push_back({feature(gen), value(gen)});
+    }
+
+    printf("readers : %zu, seconds : %g, publish interval : %zu ms, dimension : %zu\n",
+           n_readers, seconds, interval_ms, dimension);
+    printf("|%16s|%10s|%12s|%9s|%9s|%9s|%10s|\n", "mode", "publishes", "Mpredict/s",
+           "p50(ns)", "p99(ns)", "p99.9(ns)", "max(ns)");
+    run("handle", kHandle, n_readers, seconds, interval_ms, model_file, samples);
+    run("handle+publish", kHandlePublish, n_readers, seconds, interval_ms, model_file, samples);
+    run("mutex+publish", kMutexPublish, n_readers, seconds, interval_ms, model_file, samples);
+
+    remove(model_file.c_str());
+    return EXIT_SUCCESS;
+}
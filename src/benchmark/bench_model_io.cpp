@@ -0,0 +1,78 @@
+// Benchmark of model loading, the time of reading back a model written
+// in the text and in the binary format, and the time of the first
+// prediction after loading
+//
+// Usage: bench_model_io [dimension] [n_classes] [directory]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <random>
+#include "logistic.hpp"
+#include "high_level_function.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point& start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * Load the model file and predict a sample, print the times
+ */
+static void run(const char* name, const std::string& filename, const oplin::FeatureVector& x)
+{
+    Clock::time_point start = Clock::now();
+    oplin::LogisticRegression lr(oplin::read_model(filename));
+    const double load_s = seconds_since(start);
+    start = Clock::now();
+    const double label = lr.predict(x);
+    const double predict_s = seconds_since(start);
+    printf("|%8s|%12.4f|%16.1f|%10g|\n", name, load_s, predict_s * 1e6, label);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t dimension = argc > 1 ? atoi(argv[1]) : 10000000;
+    const size_t n_classes = argc > 2 ? atoi(argv[2]) : 2;
+    const std::string directory = argc > 3 ? argv[3] : "/tmp";
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::uniform_int_distribution<size_t> feature(0, dimension - 1);
+
+    oplin::ModelUniPtr model(new oplin::Model());
+    model->n_classes = n_classes;
+    model->dimension = dimension;
+    model->bias = -1;
+    for(size_t k = 0; k < n_classes; ++k)
+        model->labels.push_back(k);
+    double* W = new double[dimension * n_ws];
+    for(size_t j = 0; j < dimension * n_ws; ++j)
+        W[j] = value(gen);
+    model->set_weights(W);
+    oplin::LogisticRegression lr(std::move(model));
+
+    const std::string text_file = directory + "/bench_model_io.txt";
+    const std::string binary_file = directory + "/bench_model_io.bin";
+    lr.export_model_to_file(text_file, false);
+    lr.export_model_to_file(binary_file, true);
+
+    oplin::FeatureVector x;
+    for(size_t k = 0; k < 30; ++k)
+        x.push_back({feature(gen), value(gen)});
+
+    printf("dimension : %zu, n_classes : %zu\n", dimension, n_classes);
+    printf("|%8s|%12s|%16s|%10s|\n", "format", "load(s)", "1st predict(us)", "label");
+    run("text", text_file, x);
+    run("binary", binary_file, x);
+
+    remove(text_file.c_str());
+    remove(binary_file.c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+// Benchmark on libsvm dataset parsing throughput
+//
+// Usage: bench_parser dataset_file [max_threads]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <thread>
+#include "high_level_function.hpp"
+
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point& start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        cout << "Usage: bench_parser dataset_file [max_threads]" << endl;
+        return EXIT_FAILURE;
+    }
+    std::string sample_file(argv[1]);
+    size_t max_threads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+    if(max_threads == 0) max_threads = 1;
+
+    oplin::MappedFile file(sample_file);
+    const double mb = file.size() / (1024. * 1024.);
+    printf("file : %s (%.1f MB)\n", sample_file.c_str(), mb);
+    printf("|%8s|%12s|%12s|%12s|\n", "#threads", "parse(s)", "parse(MB/s)", "read(MB/s)");
+
+    for(size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+    {
+        // parsing only
+        std::vector<oplin::ParsedChunk> chunks;
+        Clock::time_point start = Clock::now();
+        oplin::parse_libsvm(file.data(), file.size(), n_threads, chunks);
+        const double t_parse = seconds_since(start);
+        chunks.clear();
+
+        // parsing and matrix construction
+        start = Clock::now();
+        oplin::DatasetPtr dataset = oplin::read_dataset(sample_file, -1, n_threads);
+        const double t_read = seconds_since(start);
+
+        printf("|%8zu|%12.3f|%12.1f|%12.1f|\n", n_threads, t_parse, mb / t_parse, mb / t_read);
+    }
+
+    return EXIT_SUCCESS;
+}
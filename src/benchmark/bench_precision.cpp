@@ -0,0 +1,98 @@
+// Benchmark of the feature precision (see FeatureScalar) on training an
+// L2-regularized logistic regression: memory of features, time of a
+// loss and gradient pass, time of solving by TRON, the objective and the
+// training accuracy. Build once with and once without SINGLE_PRECISION=yes
+// and compare the outputs.
+//
+// Usage: bench_precision [libsvm_file | n_samples dimension nnz_per_sample] [n_threads]
+//
+// A libsvm file is read as a binary problem, its first label is positive.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include "solver.hpp"
+#include "high_level_function.hpp"
+#include "synthetic_dataset.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point& start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    oplin::DatasetPtr dataset;
+    size_t n_threads = 1;
+    if(argc == 2 || argc == 3)
+    {
+        dataset = oplin::read_dataset(argv[1]);
+        for(size_t i = 0; i < dataset->n_samples; ++i)
+            dataset->y[i] = dataset->y[i] == dataset->labels[0] ? 1 : -1;
+        n_threads = argc > 2 ? atoi(argv[2]) : 1;
+    }
+    else
+    {
+        const size_t n_samples = argc > 1 ? atoi(argv[1]) : 1000000;
+        const size_t dimension = argc > 2 ? atoi(argv[2]) : 100000;
+        const size_t nnz_per_sample = argc > 3 ? atoi(argv[3]) : 30;
+        dataset = synthetic_dataset(n_samples, dimension, nnz_per_sample);
+        n_threads = argc > 4 ? atoi(argv[4]) : 1;
+    }
+    const oplin::SpColMatrixMap& X = *(dataset->X);
+    const size_t value_size = dataset->binary_features() ? 0 : sizeof(oplin::FeatureScalar);
+    const size_t feature_bytes = X.nonZeros() * (value_size + sizeof(oplin::FeatureIndex)) +
+                                 (X.cols() + 1) * sizeof(oplin::FeatureIndex);
+    printf("n_samples : %zu, dimension : %zu, nnz : %ld\n", dataset->n_samples, dataset->dimension,
+           (long)X.nonZeros());
+    printf("feature scalar : %s, feature memory : %.1f MB\n",
+           dataset->binary_features() ? "binary" :
+           sizeof(oplin::FeatureScalar) == sizeof(float) ? "float" : "double", feature_bytes / 1e6);
+
+    std::vector<double> C(dataset->n_samples, 1);
+    std::shared_ptr<oplin::L2R_LR_Problem> problem = std::make_shared<oplin::L2R_LR_Problem>(dataset, C);
+    problem->set_n_threads(n_threads);
+    oplin::ColVector w = oplin::ColVector::Zero(dataset->dimension);
+
+    // a pass over X
+    const size_t n_repeats = 10;
+    oplin::ColVector grad(dataset->dimension);
+    Clock::time_point start = Clock::now();
+    for(size_t r = 0; r < n_repeats; ++r)
+        problem->loss_and_gradient(w, grad);
+    const double pass_ms = seconds_since(start) * 1000 / n_repeats;
+
+    oplin::ParamPtr param = std::make_shared<oplin::Parameter>();
+    param->problem_type = oplin::L2R_LR;
+    param->n_threads = n_threads;
+    param->max_epoch = 100;
+    param->rela_tol = 1e-6;
+    param->abs_tol = 0;
+    Eigen::Ref<oplin::ColVector> w_ref(w);
+    start = Clock::now();
+    class oplin::TRON solver;
+    solver.solve(problem, param, w_ref);
+    const double solve_s = seconds_since(start);
+
+    const double f = problem->loss(w);
+    const oplin::FeatureValues values(X.valuePtr());
+    size_t n_correct = 0;
+    for(size_t i = 0; i < dataset->n_samples; ++i)
+    {
+        double wTx = 0;
+        for(auto k = X.outerIndexPtr()[i]; k < X.outerIndexPtr()[i+1]; ++k)
+            wTx += values[k] * w(X.innerIndexPtr()[k]);
+        n_correct += (wTx > 0 ? 1 : -1) == dataset->y[i];
+    }
+
+    printf("|%10s|%10s|%18s|%10s|\n", "pass(ms)", "solve(s)", "objective", "accuracy");
+    printf("|%10.2f|%10.3f|%18.8f|%9.4f%%|\n", pass_ms, solve_s, f,
+           100. * n_correct / dataset->n_samples);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+// Benchmark of prediction, the time and the heap allocations per sample
+// of every single sample predict API and of predict_batch
+//
+// Usage: bench_predict [dimension] [nnz_per_sample] [n_classes] [density] [weight_type]
+//
+// A fraction density of the weights are non-zero, the model is sparse
+// if Model::compact chooses so. The weights are quantized by
+// weight_type, see WeightType.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <numeric>
+#include "logistic.hpp"
+
+// count every heap allocation of the process
+static std::atomic<size_t> n_allocations(0);
+
+void* operator new(size_t size)
+{
+    ++n_allocations;
+    void* p = malloc(size ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Run fn(0), ..., fn(n_calls - 1) and print the time and allocations per
+ * sample
+ */
+template <class Function>
+static void run(const char* name, size_t n_calls, size_t n_samples, Function fn)
+{
+    const size_t n_repeats = 10;
+    // warm up, per thread buffers are allocated by the first call
+    double sum = 0;
+    for(size_t i = 0; i < n_calls; ++i)
+        sum += fn(i);
+
+    const size_t allocations = n_allocations;
+    Clock::time_point start = Clock::now();
+    for(size_t r = 0; r < n_repeats; ++r)
+    {
+        for(size_t i = 0; i < n_calls; ++i)
+            sum += fn(i);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const size_t n_predicted = n_repeats * n_samples;
+    printf("|%28s|%10.1f|%14.4f|%12g|\n", name, seconds * 1e9 / n_predicted,
+           double(n_allocations - allocations) / n_predicted, sum);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t dimension = argc > 1 ? atoi(argv[1]) : 100000;
+    const size_t nnz_per_sample = argc > 2 ? atoi(argv[2]) : 30;
+    const size_t n_classes = argc > 3 ? atoi(argv[3]) : 2;
+    const double density = argc > 4 ? atof(argv[4]) : 1;
+    const int weight_type = argc > 5 ? atoi(argv[5]) : oplin::WEIGHT_DOUBLE;
+    const size_t n_samples = 100000;
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<size_t> feature(0, dimension - 1);
+    std::uniform_real_distribution<double> value(-1, 1);
+
+    oplin::ModelUniPtr model(new oplin::Model());
+    model->n_classes = n_classes;
+    model->dimension = dimension;
+    model->bias = -1;
+    for(size_t k = 0; k < n_classes; ++k)
+        model->labels.push_back(k);
+    double* W = new double[dimension * n_ws];
+    std::bernoulli_distribution non_zero(density);
+    for(size_t j = 0; j < dimension; ++j)
+    {
+        const bool keep = non_zero(gen);
+        for(size_t c = 0; c < n_ws; ++c)
+            W[j * n_ws + c] = keep ? value(gen) : 0;
+    }
+    model->set_weights(W);
+    model->compact();
+    model->quantize(weight_type);
+    const bool sparse = model->sparse();
+    oplin::LogisticRegression lr(std::move(model));
+
+    std::vector<oplin::FeatureVector> samples(n_samples);
+    for(size_t i = 0; i < n_samples; ++i)
+    {
+        for(size_t k = 0; k < nnz_per_sample; ++k)
+            samples[i].push_back({feature(gen), value(gen)});
+    }
+
+    // the samples in blocks of compressed columns for predict_batch
+    const size_t block_size = 4096;
+    const size_t n_blocks = (n_samples + block_size - 1) / block_size;
+    std::vector<std::vector<oplin::FeatureIndex> > outer(n_blocks), inner(n_blocks);
+    std::vector<std::vector<oplin::FeatureScalar> > values(n_blocks);
+    for(size_t i = 0; i < n_samples; ++i)
+    {
+        const size_t b = i / block_size;
+        if(outer[b].empty())
+            outer[b].push_back(0);
+        for(size_t k = 0; k < samples[i].size(); ++k)
+        {
+            inner[b].push_back(samples[i][k].i);
+            values[b].push_back(samples[i][k].v);
+        }
+        outer[b].push_back(inner[b].size());
+    }
+
+    const char* weight_names[] = {"double", "int8", "fp16"};
+    printf("dimension : %zu, nnz : %zu, n_classes : %zu, density : %g (%s model of %s weights)\n",
+           dimension, nnz_per_sample, n_classes, density, sparse ? "sparse" : "dense",
+           weight_names[weight_type]);
+    printf("|%28s|%10s|%14s|%12s|\n", "api", "ns/sample", "allocs/sample", "checksum");
+    run("predict(vector)", n_samples, n_samples, [&](size_t i)
+    {
+        return lr.predict(samples[i]);
+    });
+    std::vector<double> buffer(n_classes);
+    run("predict(span, buffer)", n_samples, n_samples, [&](size_t i)
+    {
+        return lr.predict(samples[i].data(), samples[i].size(), buffer.data());
+    });
+    std::vector<double> probability;
+    run("predict_proba(vector)", n_samples, n_samples, [&](size_t i)
+    {
+        return lr.predict_proba(samples[i], probability);
+    });
+    run("predict_proba(span, buffer)", n_samples, n_samples, [&](size_t i)
+    {
+        return lr.predict_proba(samples[i].data(), samples[i].size(), buffer.data());
+    });
+
+    std::vector<double> labels(block_size), probabilities(block_size * n_classes);
+    auto predict_block = [&](size_t b, double* p)
+    {
+        oplin::SpColMatrixMap X(dimension, outer[b].size() - 1, inner[b].size(),
+                                outer[b].data(), inner[b].data(), values[b].data());
+        lr.predict_batch(X, labels.data(), p);
+        return std::accumulate(labels.begin(), labels.begin() + X.cols(), 0.);
+    };
+    run("predict_batch", n_blocks, n_samples, [&](size_t b)
+    {
+        return predict_block(b, NULL);
+    });
+    run("predict_batch(probability)", n_blocks, n_samples, [&](size_t b)
+    {
+        return predict_block(b, probabilities.data());
+    });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+// Benchmark of quantized weights (see Model::quantize), the memory of
+// weights, the time of predict_batch, the accuracy and the AUC of a model
+// stored in double, int8 and fp16 on a holdout file, and their deltas
+// against the double model
+//
+// Usage: bench_quantize model_file holdout_file
+//
+// The holdout file is a libsvm file read without bias term, as predict
+// does. The AUC of more than 2 classes is the mean of the one-vs-rest AUC
+// of every class.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <cmath>
+#include "logistic.hpp"
+#include "high_level_function.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Area under ROC curve of scores, tied scores share their mean rank
+ *
+ * @param scores   score of every sample
+ * @param positive true if the sample is positive
+ */
+static double auc(const std::vector<double>& scores, const std::vector<bool>& positive)
+{
+    const size_t n = scores.size();
+    std::vector<size_t> order(n);
+    for(size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return scores[a] < scores[b]; });
+    double rank_sum = 0;
+    size_t n_positives = 0;
+    for(size_t begin = 0; begin < n; )
+    {
+        size_t end = begin + 1;
+        while(end < n && scores[order[end]] == scores[order[begin]])
+            ++end;
+        // 1-based ranks begin + 1, ..., end
+        const double rank = (begin + 1 + end) / 2.;
+        for(size_t r = begin; r < end; ++r)
+        {
+            if(positive[order[r]])
+            {
+                rank_sum += rank;
+                ++n_positives;
+            }
+        }
+        begin = end;
+    }
+    const size_t n_negatives = n - n_positives;
+    if(n_positives == 0 || n_negatives == 0)
+        return NAN;
+    return (rank_sum - n_positives * (n_positives + 1) / 2.) / ((double)n_positives * n_negatives);
+}
+
+/// Scores of a model on the holdout
+struct Evaluation
+{
+    double accuracy;
+    double auc;
+    double ns_per_sample;
+    std::vector<double> probability;
+};
+
+static Evaluation evaluate(oplin::LogisticRegression& lr, const std::vector<double>& model_labels,
+                           const oplin::Dataset& holdout)
+{
+    const oplin::SpColMatrixMap& X = *(holdout.X);
+    const size_t n = X.cols();
+    const size_t n_classes = model_labels.size();
+    std::vector<double> labels(n);
+    Evaluation result;
+    result.probability.resize(n * n_classes);
+
+    const size_t n_repeats = 10;
+    // warm up, the per thread buffer is allocated by the first call
+    lr.predict_batch(X, labels.data(), result.probability.data());
+    Clock::time_point start = Clock::now();
+    for(size_t r = 0; r < n_repeats; ++r)
+        lr.predict_batch(X, labels.data(), result.probability.data());
+    result.ns_per_sample = std::chrono::duration<double>(Clock::now() - start).count() * 1e9 /
+                           (n_repeats * n);
+
+    size_t n_correct = 0;
+    for(size_t i = 0; i < n; ++i)
+        n_correct += labels[i] == holdout.y[i];
+    result.accuracy = (double)n_correct / n;
+
+    // the probability of the first label for binary classification
+    const size_t n_aucs = n_classes == 2 ? 1 : n_classes;
+    std::vector<double> scores(n);
+    std::vector<bool> positive(n);
+    result.auc = 0;
+    for(size_t c = 0; c < n_aucs; ++c)
+    {
+        for(size_t i = 0; i < n; ++i)
+        {
+            scores[i] = result.probability[i * n_classes + c];
+            positive[i] = holdout.y[i] == model_labels[c];
+        }
+        result.auc += auc(scores, positive) / n_aucs;
+    }
+    return result;
+}
+
+/** bytes of the weights, the index of sparse model and the scales */
+static size_t weight_bytes(const oplin::Model& model)
+{
+    const size_t n_ws = model.n_classes == 2 ? 1 : model.n_classes;
+    return model.n_weight_rows() * n_ws * model.weight_size() + model.n_scales() * sizeof(float) +
+           (model.sparse() ? model.index_size() * sizeof(uint64_t) : 0);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 3)
+    {
+        printf("Usage: bench_quantize model_file holdout_file\n");
+        return EXIT_FAILURE;
+    }
+    oplin::DatasetPtr holdout = oplin::read_dataset(argv[2]);
+    printf("holdout : %zu samples, model : %s\n", holdout->n_samples, argv[1]);
+    printf("|%8s|%12s|%10s|%10s|%12s|%10s|%12s|%14s|\n", "weights", "memory(KB)", "ns/sample",
+           "accuracy", "d_accuracy", "auc", "d_auc", "max |d_prob|");
+
+    const char* names[] = {"double", "int8", "fp16"};
+    const int types[] = {oplin::WEIGHT_DOUBLE, oplin::WEIGHT_INT8, oplin::WEIGHT_FP16};
+    Evaluation reference = Evaluation();
+    for(size_t t = 0; t < 3; ++t)
+    {
+        oplin::ModelUniPtr model = oplin::read_model(argv[1]);
+        if(model->quantized())
+        {
+            printf("The model is already quantized, please give a model of double weights\n");
+            return EXIT_FAILURE;
+        }
+        model->quantize(types[t]);
+        const size_t bytes = weight_bytes(*model);
+        const std::vector<double> labels = model->labels;
+        oplin::LogisticRegression lr(std::move(model));
+        Evaluation result = evaluate(lr, labels, *holdout);
+        if(t == 0)
+            reference = result;
+        double max_delta = 0;
+        for(size_t k = 0; k < result.probability.size(); ++k)
+            max_delta = std::max(max_delta, std::fabs(result.probability[k] - reference.probability[k]));
+        printf("|%8s|%12.1f|%10.1f|%9.4f%%|%11.4f%%|%10.6f|%12.2e|%14.2e|\n", names[t], bytes / 1024.,
+               result.ns_per_sample, 100 * result.accuracy, 100 * (result.accuracy - reference.accuracy),
+               result.auc, result.auc - reference.auc, max_delta);
+    }
+
+    return EXIT_SUCCESS;
+}
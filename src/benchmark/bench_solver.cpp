@@ -0,0 +1,108 @@
+// Benchmark of solvers on L2-regularized logistic regression over a
+// synthetic sparse dataset, counting the passes over X and the wall time
+// to reach the same loss. The target loss is (1 + gap) times the optimum
+// found by TRON with tight tolerance.
+//
+// Usage: bench_solver [n_samples] [dimension] [nnz_per_sample] [gap] [n_threads] [learning_rate]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include "solver.hpp"
+#include "synthetic_dataset.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/// L2R_LR_Problem counting evaluations which read whole X
+class CountingProblem : public oplin::L2R_LR_Problem
+{
+public:
+    CountingProblem(oplin::DatasetPtr dataset, const std::vector<double>& C)
+        : oplin::L2R_LR_Problem(dataset, C), passes(0) {}
+
+    double loss(const Eigen::Ref<const oplin::ColVector>& w)
+    {
+        ++passes;
+        return oplin::L2R_LR_Problem::loss(w);
+    }
+    void gradient(const Eigen::Ref<const oplin::ColVector>& w, Eigen::Ref<oplin::ColVector> grad)
+    {
+        ++passes;
+        oplin::L2R_LR_Problem::gradient(w, grad);
+    }
+    double loss_and_gradient(const Eigen::Ref<const oplin::ColVector>& w, Eigen::Ref<oplin::ColVector> grad)
+    {
+        ++passes;
+        return oplin::L2R_LR_Problem::loss_and_gradient(w, grad);
+    }
+    bool init_direction(const Eigen::Ref<const oplin::ColVector>& w, const Eigen::Ref<const oplin::ColVector>& p)
+    {
+        ++passes;
+        return oplin::L2R_LR_Problem::init_direction(w, p);
+    }
+    void hessian_vector(const Eigen::Ref<const oplin::ColVector>& w, const Eigen::Ref<const oplin::ColVector>& v,
+                        Eigen::Ref<oplin::ColVector> Hv)
+    {
+        ++passes;
+        oplin::L2R_LR_Problem::hessian_vector(w, v, Hv);
+    }
+
+    size_t passes;
+};
+
+/**
+ * Solve the problem and print the loss, passes over X and time
+ */
+static double run(const char* name, std::shared_ptr<oplin::SolverBase> solver,
+                  oplin::DatasetPtr dataset, oplin::ParamPtr param)
+{
+    std::vector<double> C(dataset->n_samples, 1);
+    std::shared_ptr<CountingProblem> problem = std::make_shared<CountingProblem>(dataset, C);
+    problem->set_n_threads(param->n_threads);
+    oplin::ColVector w = oplin::ColVector::Zero(dataset->dimension);
+    Eigen::Ref<oplin::ColVector> w_ref(w);
+
+    Clock::time_point start = Clock::now();
+    solver->solve(problem, param, w_ref);
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const size_t passes = problem->passes;
+    const double f = problem->loss(w);
+    printf("|%8s|%15.6f|%8zu|%10.3f|\n", name, f, passes, seconds);
+    return f;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t n_samples = argc > 1 ? atoi(argv[1]) : 1000000;
+    const size_t dimension = argc > 2 ? atoi(argv[2]) : 100000;
+    const size_t nnz_per_sample = argc > 3 ? atoi(argv[3]) : 30;
+    const double gap = argc > 4 ? atof(argv[4]) : 2e-2;
+
+    oplin::DatasetPtr dataset = synthetic_dataset(n_samples, dimension, nnz_per_sample);
+    printf("n_samples : %zu, dimension : %zu, nnz : %ld\n", n_samples, dimension,
+           (long)dataset->X->nonZeros());
+
+    oplin::ParamPtr param = std::make_shared<oplin::Parameter>();
+    param->problem_type = oplin::L2R_LR;
+    param->n_threads = argc > 5 ? atoi(argv[5]) : 1;
+    param->learning_rate = argc > 6 ? atof(argv[6]) : 0.02;
+    param->max_epoch = 1000;
+
+    printf("|%8s|%15s|%8s|%10s|\n", "solver", "loss", "#passes", "time(s)");
+    // optimum
+    param->rela_tol = 1e-10;
+    param->abs_tol = 0;
+    const double optimum = run("optimum", std::make_shared<class oplin::TRON>(), dataset, param);
+
+    // time to reach the target loss
+    param->rela_tol = 0;
+    param->abs_tol = optimum * (1 + gap);
+    run("L-BFGS", std::make_shared<oplin::LBFGS>(), dataset, param);
+    run("TRON", std::make_shared<class oplin::TRON>(), dataset, param);
+    run("SGD", std::make_shared<oplin::StochasticGD>(), dataset, param);
+
+    return EXIT_SUCCESS;
+}
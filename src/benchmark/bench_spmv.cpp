@@ -0,0 +1,74 @@
+// Benchmark on the scaling of multi-threaded sparse kernels of LR_Problem
+// over a synthetic sparse dataset
+//
+// Usage: bench_spmv [n_samples] [dimension] [nnz_per_sample] [max_threads] [binary]
+//
+// Features are one-hot and stored without values if binary is 1.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <thread>
+#include "formula.hpp"
+#include "synthetic_dataset.hpp"
+
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(const Clock::time_point& start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    const size_t n_samples = argc > 1 ? atoi(argv[1]) : 1000000;
+    const size_t dimension = argc > 2 ? atoi(argv[2]) : 100000;
+    const size_t nnz_per_sample = argc > 3 ? atoi(argv[3]) : 50;
+    const size_t max_threads = argc > 4 ? atoi(argv[4]) : std::thread::hardware_concurrency();
+    const bool binary = argc > 5 ? atoi(argv[5]) != 0 : false;
+    const size_t n_repeats = 5;
+
+    oplin::DatasetPtr dataset = synthetic_dataset(n_samples, dimension, nnz_per_sample, binary);
+    printf("n_samples : %zu, dimension : %zu, nnz : %ld\n", n_samples, dimension,
+           (long)dataset->X->nonZeros());
+
+    std::vector<double> C(n_samples, 1);
+    oplin::L2R_LR_Problem problem(dataset, C);
+    oplin::ColVector w = oplin::ColVector::Constant(dimension, 1e-3);
+    oplin::ColVector grad(dimension);
+
+    printf("|%8s|%12s|%12s|%12s|%8s|\n", "#threads", "loss(ms)", "gradient(ms)", "fused(ms)", "speedup");
+    double base = 0;
+    for(size_t n_threads = 1; n_threads <= std::max<size_t>(max_threads, 1); n_threads *= 2)
+    {
+        problem.set_n_threads(n_threads);
+        double t_loss = 0, t_grad = 0, t_fused = 0;
+        for(size_t r = 0; r < n_repeats; ++r)
+        {
+            Clock::time_point start = Clock::now();
+            problem.loss(w);
+            t_loss += seconds_since(start);
+
+            start = Clock::now();
+            problem.gradient(w, grad);
+            t_grad += seconds_since(start);
+
+            start = Clock::now();
+            problem.loss_and_gradient(w, grad);
+            t_fused += seconds_since(start);
+        }
+        const double scale = 1000. / n_repeats;
+        if(n_threads == 1)
+            base = t_loss + t_grad;
+        printf("|%8zu|%12.2f|%12.2f|%12.2f|%8.2f|\n", n_threads, t_loss * scale, t_grad * scale,
+               t_fused * scale, base / (t_loss + t_grad));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+// Benchmark of warm start (see Parameter::warm_start and
+// LinearBase::partial_fit) on a daily retraining over a sliding window:
+// the model of the former window is trained from scratch, then the model
+// of the window shifted by the samples of a new day is trained from
+// scratch, from the former model, and by partial_fit. The time, the mean
+// log loss and the accuracy on the new window are compared.
+//
+// Usage: bench_warm_start [window] [day] [dimension] [nnz_per_sample] [solver] [problem]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <chrono>
+#include <cmath>
+#include "logistic.hpp"
+#include "synthetic_dataset.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/** samples [begin, begin + n) of dataset */
+static oplin::DatasetPtr window(const oplin::Dataset& dataset, size_t begin, size_t n)
+{
+    oplin::DatasetPtr result = std::make_shared<oplin::Dataset>();
+    result->n_samples = n;
+    result->dimension = dataset.dimension;
+    result->n_classes = dataset.n_classes;
+    result->labels = dataset.labels;
+    result->bias = dataset.bias;
+    result->y.assign(dataset.y.begin() + begin, dataset.y.begin() + begin + n);
+    result->set_X(std::make_shared<oplin::SpColMatrix>(dataset.X->middleCols(begin, n)));
+    return result;
+}
+
+/**
+ * Train by fn and print the time, mean log loss and accuracy on dataset
+ */
+template <class Function>
+static void run(const char* name, oplin::LogisticRegression& lr, const oplin::Dataset& dataset,
+                Function fn)
+{
+    Clock::time_point start = Clock::now();
+    fn();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const size_t n = dataset.n_samples;
+    std::vector<double> labels(n), probability(n * 2);
+    lr.predict_batch(*(dataset.X), labels.data(), probability.data());
+    const std::vector<double> model_labels = lr.get_labels();
+    double loss = 0;
+    size_t n_correct = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        const size_t c = dataset.y[i] == model_labels[0] ? 0 : 1;
+        loss -= std::log(std::max(probability[i * 2 + c], 1e-15));
+        n_correct += labels[i] == dataset.y[i];
+    }
+    printf("|%14s|%10.3f|%12.6f|%9.4f%%|\n", name, seconds, loss / n, 100. * n_correct / n);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t window_size = argc > 1 ? atoi(argv[1]) : 300000;
+    const size_t day = argc > 2 ? atoi(argv[2]) : 10000;
+    const size_t dimension = argc > 3 ? atoi(argv[3]) : 100000;
+    const size_t nnz_per_sample = argc > 4 ? atoi(argv[4]) : 30;
+
+    oplin::ParamPtr param = std::make_shared<oplin::Parameter>();
+    param->solver_type = argc > 5 ? atoi(argv[5]) : oplin::L_BFGS;
+    param->problem_type = argc > 6 ? atoi(argv[6]) : oplin::L2R_LR;
+    param->rela_tol = 1e-5;
+    param->abs_tol = 0.1;
+    param->max_epoch = 500;
+    param->learning_rate = 0.01;
+    param->base_C = 1;
+
+    oplin::DatasetPtr dataset = synthetic_dataset(window_size + day, dimension, nnz_per_sample);
+    dataset->bias = -1;
+    printf("window : %zu, day : %zu, dimension : %zu, nnz : %zu, solver : %d, problem : %d\n",
+           window_size, day, dimension, nnz_per_sample, param->solver_type, param->problem_type);
+    printf("|%14s|%10s|%12s|%10s|\n", "training", "time(s)", "mean loss", "accuracy");
+
+    // the models of yesterday, of which one is retrained by warm start and
+    // the other by partial_fit
+    oplin::DatasetPtr yesterday = window(*dataset, 0, window_size);
+    oplin::LogisticRegression warm, partial;
+    run("yesterday", warm, *yesterday, [&]{ warm.train(yesterday, param); });
+    partial.train(yesterday, param);
+
+    oplin::DatasetPtr today = window(*dataset, day, window_size);
+    oplin::LogisticRegression cold;
+    run("cold", cold, *today, [&]{ cold.train(today, param); });
+    oplin::ParamPtr warm_param = std::make_shared<oplin::Parameter>(*param);
+    warm_param->warm_start = true;
+    run("warm start", warm, *today, [&]{ warm.train(today, warm_param); });
+    run("partial_fit", partial, *today, [&]{ partial.partial_fit(today); });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+// Synthetic sparse dataset for benchmarks
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_SYNTHETIC_DATASET_H_
+#define OPENLINEAR_SYNTHETIC_DATASET_H_
+
+#include <random>
+#include "linear.hpp"
+
+/**
+ * Generate a random sparse dataset with uniformly distributed features,
+ * labels are given by a random hyperplane with 10% of them flipped. The
+ * features are all ones (one-hot) if binary is true, stored without values.
+ */
+inline oplin::DatasetPtr synthetic_dataset(size_t n_samples, size_t dimension, size_t nnz_per_sample,
+                                           bool binary = false)
+{
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int> feature(0, dimension - 1);
+    std::uniform_real_distribution<double> value(-1, 1);
+
+    std::vector<double> w_true(dimension);
+    for(size_t k = 0; k < dimension; ++k)
+        w_true[k] = value(gen);
+
+    oplin::SpColMatrixPtr X = std::make_shared<oplin::SpColMatrix>(dimension, n_samples);
+    oplin::SpColPatternPtr pattern = std::make_shared<oplin::SpColPattern>(dimension, n_samples, 0);
+    if(binary)
+        pattern->inner.reserve(n_samples * nnz_per_sample);
+    else
+        X->reserve(Eigen::VectorXi::Constant(n_samples, nnz_per_sample));
+    oplin::DatasetPtr dataset = std::make_shared<oplin::Dataset>();
+    dataset->y.resize(n_samples);
+    std::vector<int> features;
+    for(size_t j = 0; j < n_samples; ++j)
+    {
+        features.clear();
+        for(size_t k = 0; k < nnz_per_sample; ++k)
+            features.push_back(feature(gen));
+        std::sort(features.begin(), features.end());
+        features.erase(std::unique(features.begin(), features.end()), features.end());
+        double wTx = 0;
+        for(size_t k = 0; k < features.size(); ++k)
+        {
+            double x = value(gen);
+            if(binary)
+            {
+                x = 1;
+                pattern->inner.push_back(features[k]);
+            }
+            else
+                X->insert(features[k], j) = x;
+            wTx += w_true[features[k]] * x;
+        }
+        pattern->outer[j+1] = pattern->inner.size();
+        dataset->y[j] = (wTx > 0) != (value(gen) > 0.8) ? 1 : -1;
+    }
+
+    dataset->n_samples = n_samples;
+    dataset->dimension = dimension;
+    dataset->n_classes = 2;
+    dataset->labels = {1, -1};
+    if(binary)
+        dataset->set_X(pattern);
+    else
+        dataset->set_X(X);
+    return dataset;
+}
+
+#endif// OPENLINEAR_SYNTHETIC_DATASET_H_
@@ -0,0 +1,83 @@
+// Command line interface for converting libsvm dataset to binary format
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <getopt.h>
+#include "high_level_function.hpp"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+void print_help()
+{
+    cout
+    << "Usage: convert [convert options] dataset_file binary_file" << endl
+    << "Convert libsvm dataset to binary dataset, which can be given to train"
+        " directly and loaded without parsing" << endl
+    << "convert options:" << endl
+    << "-b [--bias]: Bias term, -1 for no bias term applied (default -1)" <<endl
+    << "-H [--hash_bits]: <-H b> hash the features into 2^b features (b <= 30), the token before"
+        " ':' is any feature name and a token without ':' has value 1 (default 0, no hashing)" << endl
+    << "-g [--signed_hash]: Flip the sign of hashed feature values by a bit of hash (no value needed)" << endl
+    << "-h [--help]: Print usage help information"
+    <<endl;
+}
+
+int main(int argc, char **argv)
+{
+    double bias = -1;
+    oplin::FeatureHashing hashing;
+    struct option long_options[] = {
+        {"bias",     required_argument, 0,  'b' },
+        {"hash_bits",required_argument, 0,  'H' },
+        {"signed_hash",no_argument, 0,  'g' },
+        {"help",     no_argument,       0,  'h' },
+        {0,0,0,0}
+    };
+
+    int opt,option_index = 0;
+    while ((opt = getopt_long(argc, argv, "b:hH:g",
+                              long_options, &option_index)) != -1) {
+        switch (opt) {
+        case 'b':
+            bias = atof(optarg);
+            break;
+        case 'H':
+            hashing.bits = atoi(optarg);
+            break;
+        case 'g':
+            hashing.signed_hash = true;
+            break;
+        case 'h':
+            print_help();
+            return EXIT_SUCCESS;
+        case '?':
+            print_help();
+            return EXIT_FAILURE;
+        default: /* '?' */
+            print_help();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // +2 for dataset file and binary file
+    if (optind + 2 != argc)
+    {
+        print_help();
+        return EXIT_FAILURE;
+    }
+
+    std::string sample_file(argv[optind++]);
+    std::string binary_file(argv[optind++]);
+    cout << "input sample file : " << sample_file << endl;
+    cout << "output binary file : " << binary_file << endl;
+
+    oplin::DatasetPtr dataset = oplin::read_dataset(sample_file, bias, 0, hashing);
+    oplin::save_dataset_binary(dataset, binary_file);
+
+    return EXIT_SUCCESS;
+}
@@ -21,6 +21,10 @@ void print_help()
     << "-p [--probability]: Output the probability or not (no value needed)" <<endl
     << "-e [--estimate_n_samples]: Estimation on number of training samples."
         " Precise estimation can improve the memory usage (default 100)" << endl
+    << "-t [--threads]: Number of scoring threads, 0 for all cores (default 1)" << endl
+    << "-H [--hash_bits]: <-H b> hash the features into 2^b features (b <= 30), the token before"
+        " ':' is any feature name and a token without ':' has value 1 (default 0, no hashing)" << endl
+    << "-g [--signed_hash]: Flip the sign of hashed feature values by a bit of hash (no value needed)" << endl
     << "-h [--help]: Print usage help information"
     <<endl;
 }
@@ -28,16 +32,20 @@ void print_help()
 int main(int argc, char **argv)
 {
 
-    int probability = 0,estimate_n_samples = 100;
+    int probability = 0,estimate_n_samples = 100,n_threads = 1;
+    oplin::FeatureHashing hashing;
     struct option long_options[] = {
         {"probability",   no_argument, 0,  'p' },
         {"estimate_samples",required_argument, 0,  'e' },
+        {"threads",required_argument, 0,  't' },
+        {"hash_bits",required_argument, 0,  'H' },
+        {"signed_hash",no_argument, 0,  'g' },
         {"help",     no_argument,       0,  'h' },
         {0,0,0,0}
     };
 
     int opt,option_index = 0;
-    while ((opt = getopt_long(argc, argv, "pe:h",
+    while ((opt = getopt_long(argc, argv, "pe:t:hH:g",
                               long_options, &option_index)) != -1) {
         switch (opt) {
         case 'p':
@@ -46,6 +54,15 @@ int main(int argc, char **argv)
         case 'e':
             estimate_n_samples = atoi(optarg);
             break;
+        case 't':
+            n_threads = atoi(optarg);
+            break;
+        case 'H':
+            hashing.bits = atoi(optarg);
+            break;
+        case 'g':
+            hashing.signed_hash = true;
+            break;
         case 'h':
             print_help();
             return EXIT_SUCCESS;
@@ -76,7 +93,8 @@ int main(int argc, char **argv)
 
     std::shared_ptr<oplin::LinearBase> lr= std::make_shared<oplin::LogisticRegression>();
     lr->load_model(std::move(oplin::read_model(model_file)));
-    oplin::predict_all(sample_file,output_file, lr, "\t", probability, estimate_n_samples);
+    oplin::predict_all(sample_file,output_file, lr, "\t", probability, estimate_n_samples,
+                       n_threads, hashing);
 
 
     return EXIT_SUCCESS;
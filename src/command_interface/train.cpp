@@ -23,19 +23,38 @@ void print_help()
     << "\t0 -- Steepest(Gradient) Descent" <<endl
     << "\t1 -- Stochastic Gradient Descent" <<endl
     << "\t2 -- L-BFGS" <<endl
+    << "\t3 -- Trust Region Newton (L2-regularized only)" <<endl
+    << "\t4 -- FTRL-Proximal, online in one pass, the learning rate is its alpha" <<endl
     << "-p [--problem]: Problem type (default 0)" <<endl
     << "\t0 -- L1-regularized logistic regression" <<endl
     << "\t1 -- L2-regularized logistic regression" << endl
+    << "-M [--multi_class]: Strategy for more than 2 classes (default 0)" <<endl
+    << "\t0 -- One-vs-Rest" <<endl
+    << "\t1 -- Multinomial (softmax), solver 0 or 2 only" <<endl
     << "-b [--bias]: Bias term, -1 for no bias term applied (default -1)" <<endl
     << "-r [--rela_tol]: Relative tolerance between two epochs (default 1e-5)" << endl
     << "-a [--abs_tol]: Absolute tolerance of loss (default 0.1)" << endl
     << "-m [--max_epoch]: Max epoch setting (default 500)" << endl
-    << "-e [--estimate_n_samples]: Estimation on number of training samples."
-        " Precise estimation can improve the memory usage (default 1000)" << endl
+    << "-e [--estimate_n_samples]: Deprecated and ignored, the dataset size is"
+        " no longer needed for loading" << endl
     << "-l [--learning_rate]: Learning rate setting (default 0.01)" << endl
     << "-C [--penality_base]: C base value (default 1)" << endl
     << "-c [--adjust]: <-c x1 y1 x2 y2 ...> adjust on C base value for class label 'x' with "
         "value 'y', which 'y' will be a multiplier on base value C" << endl
+    << "-t [--threads]: Number of threads for training, 0 for all cores (default 1)" << endl
+    << "-S [--stream]: <-S n> stream the dataset from disk by blocks of n samples, dataset_file is"
+        " a comma separated list of binary dataset shards (see convert), solver 0, 2 or 4 only" << endl
+    << "-q [--quantize]: Storage of the weights of model (default 0)" <<endl
+    << "\t0 -- double" <<endl
+    << "\t1 -- int8 with a scale per 64 features, 8 times smaller" <<endl
+    << "\t2 -- fp16, 4 times smaller" <<endl
+    << "-T [--text_model]: Write the model in text instead of the binary format, which is"
+        " memory mapped by predict (no value needed)" << endl
+    << "-H [--hash_bits]: <-H b> hash the features into 2^b features (b <= 30), the token before"
+        " ':' is any feature name and a token without ':' has value 1 (default 0, no hashing)" << endl
+    << "-g [--signed_hash]: Flip the sign of hashed feature values by a bit of hash (no value needed)" << endl
+    << "-w [--warm_start]: <-w model_file> start from the weights of a model of the same labels,"
+        " e.g. the model of the former day, new features start from 0 (solver 0 to 3)" << endl
     << "-h [--help]: Print usage help information"
     <<endl;
 }
@@ -50,10 +69,14 @@ int main(int argc, char **argv)
     param->max_epoch = 500;
     param->learning_rate = 0.01;
     param->base_C = 1;
+    param->n_threads = 1;
 
 
     int bias = -1;
-    size_t estimate_n_samples = 1000;
+    size_t block_size = 0;
+    bool text_model = false;
+    oplin::FeatureHashing hashing;
+    std::string warm_model_file;
     struct option long_options[] = {
         {"solver",   required_argument, 0,  's' },
         {"problem",  required_argument, 0,  'p' },
@@ -65,12 +88,20 @@ int main(int argc, char **argv)
         {"estimate_samples",required_argument, 0,  'e' },
         {"penality_base",required_argument, 0,  'C' },
         {"adjust",required_argument, 0,  'c' },
+        {"threads",required_argument, 0,  't' },
+        {"multi_class",required_argument, 0,  'M' },
+        {"stream",required_argument, 0,  'S' },
+        {"quantize",required_argument, 0,  'q' },
+        {"text_model",no_argument, 0,  'T' },
+        {"hash_bits",required_argument, 0,  'H' },
+        {"signed_hash",no_argument, 0,  'g' },
+        {"warm_start",required_argument, 0,  'w' },
         {"help",     no_argument,       0,  'h' },
         {0,0,0,0}
     };
 
     int opt,option_index = 0;
-    while ((opt = getopt_long(argc, argv, "s:p:hb:r:a:m:l:e:C:c:",
+    while ((opt = getopt_long(argc, argv, "s:p:hb:r:a:m:l:e:C:c:t:M:S:q:TH:gw:",
                               long_options, &option_index)) != -1) {
         switch (opt) {
         case 's':
@@ -95,7 +126,7 @@ int main(int argc, char **argv)
             param->learning_rate = atof(optarg);
             break;
         case 'e':
-            estimate_n_samples = atoi(optarg);
+            // kept for the compatibility of old scripts
             break;
         case 'C':
             param->base_C = atof(optarg);
@@ -117,6 +148,31 @@ int main(int argc, char **argv)
                 param->adjust_C.push_back({atof(argv[optind++]),atof(argv[optind++])});
             }
             break;
+        case 't':
+            param->n_threads = atoi(optarg);
+            break;
+        case 'M':
+            param->multi_class = atoi(optarg);
+            break;
+        case 'S':
+            block_size = atoi(optarg);
+            break;
+        case 'q':
+            param->weight_type = atoi(optarg);
+            break;
+        case 'T':
+            text_model = true;
+            break;
+        case 'H':
+            hashing.bits = atoi(optarg);
+            break;
+        case 'g':
+            hashing.signed_hash = true;
+            break;
+        case 'w':
+            warm_model_file = optarg;
+            param->warm_start = true;
+            break;
         case 'h':
             print_help();
             return EXIT_SUCCESS;
@@ -144,16 +200,42 @@ int main(int argc, char **argv)
 
     // set std::cout precision
     std::cout.precision(10);
-    // read dataset
-    oplin::DatasetPtr dataset = oplin::read_dataset(sample_file, bias, estimate_n_samples);
 
     // logistic regresion instance
-    std::shared_ptr<oplin::LinearBase> lr= std::make_shared<oplin::LogisticRegression>();
-    // train model
-    clock_t start = clock();
-    lr->train(dataset, param);
+    std::shared_ptr<oplin::LogisticRegression> lr= std::make_shared<oplin::LogisticRegression>();
+    if(param->warm_start)
+    {
+        cout << "warm start model file : " << warm_model_file << endl;
+        lr = std::make_shared<oplin::LogisticRegression>(oplin::read_model(warm_model_file));
+    }
+    clock_t start;
+    if(block_size > 0)
+    {
+        // shards are converted with their bias terms and hashing
+        if(bias > 0)
+            cout << "Warning : bias " << bias << " is ignored for streamed shards" << endl;
+        if(hashing.enabled())
+            cout << "Warning : feature hashing is ignored for streamed shards, hash them by convert" << endl;
+        std::vector<std::string> shards;
+        std::stringstream list(sample_file);
+        std::string shard;
+        while(std::getline(list, shard, ','))
+            shards.push_back(shard);
+        oplin::DatasetStreamPtr stream = std::make_shared<oplin::DatasetStream>(shards, block_size);
+        // train model
+        start = clock();
+        lr->train(stream, param);
+    }
+    else
+    {
+        // read dataset
+        oplin::DatasetPtr dataset = oplin::read_dataset(sample_file, bias, 0, hashing);
+        // train model
+        start = clock();
+        lr->train(dataset, param);
+    }
     std::cout << "time train:" << float(clock() -start)/CLOCKS_PER_SEC << std::endl;
-    lr->export_model_to_file(model_file);
+    lr->export_model_to_file(model_file, !text_model);
 
 
     return EXIT_SUCCESS;
@@ -0,0 +1,408 @@
+// Binary file formats
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "binary_io.hpp"
+#include "mapped_file.hpp"
+#include <string.h>
+#include <fstream>
+#include <sys/mman.h>
+
+namespace oplin{
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+static const char kDatasetMagic[8] = {'O','P','L','I','N','D','A','T'};
+static const char kModelMagic[8] = {'O','P','L','I','N','M','D','L'};
+
+static inline uint64_t align_up(uint64_t offset)
+{
+    return (offset + kBinaryAlignment - 1) / kBinaryAlignment * kBinaryAlignment;
+}
+
+/**
+ * Write a section and pad the file with zeros up to the next aligned
+ * offset.
+ */
+static void write_section(std::ofstream& outfile, const void* data, size_t bytes)
+{
+    static const char zeros[kBinaryAlignment] = {0};
+    outfile.write(static_cast<const char*>(data), bytes);
+    uint64_t pos = outfile.tellp();
+    outfile.write(zeros, align_up(pos) - pos);
+}
+
+/**
+ * Check if a section of count items of size bytes at offset fits in
+ * file_size bytes, without overflow on corrupted counts
+ */
+static inline bool section_fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t file_size)
+{
+    return offset <= file_size && (size == 0 || count <= (file_size - offset) / size);
+}
+
+/**
+ * Check if the file starts with the magic number
+ */
+static bool has_magic(const std::string& filename, const char (&expected)[8])
+{
+    std::ifstream infile(filename, std::ios::in | std::ios::binary);
+    char magic[sizeof(expected)];
+    if(!infile.read(magic, sizeof(magic)))
+        return false;
+    return memcmp(magic, expected, sizeof(magic)) == 0;
+}
+
+/**
+ * Check if the file is a binary dataset by the magic number
+ *
+ * @param filename input file name
+ *
+ * @return true if file starts with the magic of binary dataset
+ */
+bool
+is_binary_dataset(const std::string& filename)
+{
+    return has_magic(filename, kDatasetMagic);
+}
+
+/**
+ * Save dataset in binary format
+ *
+ * @param dataset  dataset to save
+ * @param filename output file name
+ */
+void
+save_dataset_binary(const DatasetPtr dataset, const std::string& filename)
+{
+    const SpColMatrixMap& X = *(dataset->X);
+    typedef SpColMatrix::StorageIndex StorageIndex;
+    typedef SpColMatrix::Scalar Scalar;
+
+    DatasetFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kDatasetMagic, sizeof(kDatasetMagic));
+    header.version = kDatasetFileVersion;
+    header.index_size = sizeof(StorageIndex);
+    header.value_size = sizeof(Scalar);
+    header.flags = dataset->binary_features() ? kBinaryFeatures : 0;
+    header.n_samples = dataset->n_samples;
+    header.n_classes = dataset->n_classes;
+    header.dimension = dataset->dimension;
+    header.nnz = X.nonZeros();
+    header.bias = dataset->bias;
+    header.outer_offset = align_up(sizeof(header));
+    header.inner_offset = align_up(header.outer_offset + (header.n_samples + 1) * sizeof(StorageIndex));
+    header.value_offset = align_up(header.inner_offset + header.nnz * sizeof(StorageIndex));
+    const size_t value_bytes = header.flags & kBinaryFeatures ? 0 : header.nnz * sizeof(Scalar);
+    header.y_offset = align_up(header.value_offset + value_bytes);
+    header.labels_offset = align_up(header.y_offset + header.n_samples * sizeof(double));
+    header.file_size = align_up(header.labels_offset + header.n_classes * sizeof(double));
+
+    std::ofstream outfile(filename, std::ios::out | std::ios::binary);
+    if(!outfile.is_open())
+    {
+        cerr << "save_dataset_binary : Could not open output file!"
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Could not open output file!");
+    }
+    write_section(outfile, &header, sizeof(header));
+    write_section(outfile, X.outerIndexPtr(), (header.n_samples + 1) * sizeof(StorageIndex));
+    write_section(outfile, X.innerIndexPtr(), header.nnz * sizeof(StorageIndex));
+    write_section(outfile, X.valuePtr(), value_bytes);
+    write_section(outfile, dataset->y.data(), header.n_samples * sizeof(double));
+    write_section(outfile, dataset->labels.data(), header.n_classes * sizeof(double));
+    if(!outfile)
+    {
+        cerr << "save_dataset_binary : Failed to write " << filename << ", "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Failed to write binary dataset!");
+    }
+}
+
+/**
+ * Validate the header of a binary dataset, which must be written by the
+ * current version with the same index and value types.
+ *
+ * @param header    header read from the beginning of file
+ * @param file_size size of the file
+ */
+void
+check_dataset_header(const DatasetFileHeader& header, uint64_t file_size)
+{
+    typedef SpColMatrix::StorageIndex StorageIndex;
+    typedef SpColMatrix::Scalar Scalar;
+
+    if(memcmp(header.magic, kDatasetMagic, sizeof(kDatasetMagic)) != 0)
+    {
+        cerr << "check_dataset_header : Not a binary dataset, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Bad binary dataset!");
+    }
+    if(header.version != kDatasetFileVersion ||
+       header.index_size != sizeof(StorageIndex) ||
+       (header.value_size != sizeof(Scalar) && !(header.flags & kBinaryFeatures)))
+    {
+        cerr << "check_dataset_header : Incompatible binary dataset (version "
+             << header.version << ", index size " << header.index_size
+             << ", value size " << header.value_size << "), please convert it again, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Incompatible binary dataset!");
+    }
+    const uint64_t value_size = header.flags & kBinaryFeatures ? 0 : header.value_size;
+    if(header.file_size > file_size || header.n_samples == ~(uint64_t)0 ||
+       !section_fits(header.outer_offset, header.n_samples + 1, header.index_size, header.file_size) ||
+       !section_fits(header.inner_offset, header.nnz, header.index_size, header.file_size) ||
+       !section_fits(header.value_offset, header.nnz, value_size, header.file_size) ||
+       !section_fits(header.y_offset, header.n_samples, sizeof(double), header.file_size) ||
+       !section_fits(header.labels_offset, header.n_classes, sizeof(double), header.file_size))
+    {
+        cerr << "check_dataset_header : Truncated or corrupted binary dataset, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Truncated binary dataset!");
+    }
+}
+
+/**
+ * Validate the first and the last outer index of a binary dataset, which
+ * bound the inner indices and values read by every sample
+ *
+ * @param header header of binary dataset, see check_dataset_header
+ * @param first  outer index of the first sample
+ * @param last   outer index past the last sample
+ */
+void
+check_dataset_outer(const DatasetFileHeader& header, uint64_t first, uint64_t last)
+{
+    if(first != 0 || last != header.nnz)
+    {
+        cerr << "check_dataset_outer : Corrupted outer index of binary dataset ("
+             << first << ", " << last << " of " << header.nnz << " non-zeros), "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Bad binary dataset!");
+    }
+}
+
+/**
+ * Load binary dataset. The file is memory mapped and the features X of
+ * returned dataset is a view on the mapped file, which is kept open as
+ * long as the dataset is alive. Only y and labels are copied.
+ *
+ * @param filename input file name
+ *
+ * @return shared_ptr to loaded dataset
+ */
+DatasetPtr
+load_dataset_binary(const std::string& filename)
+{
+    typedef SpColMatrix::StorageIndex StorageIndex;
+    typedef SpColMatrix::Scalar Scalar;
+
+    MappedFilePtr file = std::make_shared<MappedFile>(filename);
+    DatasetFileHeader header;
+    if(file->size() < sizeof(header))
+    {
+        cerr << "load_dataset_binary : File too small for a binary dataset, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Bad binary dataset!");
+    }
+    memcpy(&header, file->data(), sizeof(header));
+    check_dataset_header(header, file->size());
+
+    DatasetPtr dataset = std::make_shared<Dataset>();
+    if(!dataset)
+    {
+        cerr << "load_dataset_binary : DatasetPtr allocation failed, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::bad_alloc());
+    }
+    const char* base = file->data();
+    const StorageIndex* outer = reinterpret_cast<const StorageIndex*>(base + header.outer_offset);
+    check_dataset_outer(header, outer[0], outer[header.n_samples]);
+    dataset->n_samples = header.n_samples;
+    dataset->n_classes = header.n_classes;
+    dataset->dimension = header.dimension;
+    dataset->bias = header.bias;
+    const double* y = reinterpret_cast<const double*>(base + header.y_offset);
+    dataset->y.assign(y, y + header.n_samples);
+    const double* labels = reinterpret_cast<const double*>(base + header.labels_offset);
+    dataset->labels.assign(labels, labels + header.n_classes);
+    dataset->X = std::make_shared<SpColMatrixMap>(
+        header.dimension, header.n_samples, header.nnz,
+        outer, reinterpret_cast<const StorageIndex*>(base + header.inner_offset),
+        header.flags & kBinaryFeatures ? NULL : reinterpret_cast<const Scalar*>(base + header.value_offset));
+    dataset->storage = file;
+    // the features are read at every epoch of training
+    file->advise(MADV_WILLNEED);
+
+    return dataset;
+}
+
+/**
+ * Check if the file is a binary model by the magic number
+ *
+ * @param filename input file name
+ *
+ * @return true if file starts with the magic of binary model
+ */
+bool
+is_binary_model(const std::string& filename)
+{
+    return has_magic(filename, kModelMagic);
+}
+
+/**
+ * Save model in binary format
+ *
+ * @param model    model to save
+ * @param filename output file name
+ */
+void
+save_model_binary(const Model& model, const std::string& filename)
+{
+    const size_t n_ws = model.n_classes == 2 ? 1 : model.n_classes;
+    ModelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kModelMagic, sizeof(kModelMagic));
+    header.version = kModelFileVersion;
+    header.flags = (model.multinomial ? kMultinomialModel : 0) | (model.sparse() ? kSparseModel : 0) |
+                   (model.weight_type() == WEIGHT_INT8 ? kInt8Weights : 0) |
+                   (model.weight_type() == WEIGHT_FP16 ? kFp16Weights : 0);
+    header.n_classes = model.n_classes;
+    header.dimension = model.dimension;
+    header.n_rows = model.n_rows();
+    header.bias = model.bias;
+    const size_t n_rows = model.n_weight_rows();
+    const size_t index_size = model.sparse() ? model.index_size() : 0;
+    const void* weights = model.quantized() ? model.quantized_weights() : model.weights();
+    header.labels_offset = align_up(sizeof(header));
+    header.weights_offset = align_up(header.labels_offset + header.n_classes * sizeof(double));
+    header.index_offset = align_up(header.weights_offset + n_rows * n_ws * model.weight_size());
+    header.scales_offset = align_up(header.index_offset + index_size * sizeof(uint64_t));
+    header.file_size = align_up(header.scales_offset + model.n_scales() * sizeof(float));
+
+    std::ofstream outfile(filename, std::ios::out | std::ios::binary);
+    if(!outfile.is_open())
+    {
+        cerr << "save_model_binary : Could not open output file!"
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Could not open output file!");
+    }
+    write_section(outfile, &header, sizeof(header));
+    write_section(outfile, model.labels.data(), header.n_classes * sizeof(double));
+    write_section(outfile, weights, n_rows * n_ws * model.weight_size());
+    write_section(outfile, model.sparse_index(), index_size * sizeof(uint64_t));
+    write_section(outfile, model.scales(), model.n_scales() * sizeof(float));
+    if(!outfile)
+    {
+        cerr << "save_model_binary : Failed to write " << filename << ", "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Failed to write binary model!");
+    }
+}
+
+/**
+ * Load binary model. The file is memory mapped and the weights of the
+ * returned model are a view on the mapped file, which is kept open as
+ * long as the model is alive. Only labels are copied, so loading takes
+ * no time whatever the dimension is, and the pages of weights are read
+ * on first use.
+ *
+ * @param filename input file name
+ *
+ * @return unique_ptr to loaded model
+ */
+ModelUniPtr
+load_model_binary(const std::string& filename)
+{
+    MappedFilePtr file = std::make_shared<MappedFile>(filename);
+    ModelFileHeader header;
+    if(file->size() < sizeof(header))
+    {
+        cerr << "load_model_binary : File too small for a binary model, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Bad binary model!");
+    }
+    memcpy(&header, file->data(), sizeof(header));
+    if(memcmp(header.magic, kModelMagic, sizeof(kModelMagic)) != 0)
+    {
+        cerr << "load_model_binary : Not a binary model, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Bad binary model!");
+    }
+    if(header.version != kModelFileVersion)
+    {
+        cerr << "load_model_binary : Incompatible binary model (version "
+             << header.version << "), please train it again, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Incompatible binary model!");
+    }
+    const size_t n_ws = header.n_classes == 2 ? 1 : header.n_classes;
+    const bool sparse = (header.flags & kSparseModel) != 0;
+    const int weight_type = header.flags & kInt8Weights ? WEIGHT_INT8 :
+                            header.flags & kFp16Weights ? WEIGHT_FP16 : WEIGHT_DOUBLE;
+    const size_t weight_size = weight_type == WEIGHT_INT8 ? 1 : weight_type == WEIGHT_FP16 ? 2 : sizeof(double);
+    const size_t n_rows = sparse ? header.n_rows : header.dimension;
+    const size_t index_size = sparse ? 2 * ((header.dimension + 63) / 64) : 0;
+    const size_t n_scales = weight_type == WEIGHT_INT8 ? (n_rows + kQuantBlock - 1) / kQuantBlock : 0;
+    // n_classes and dimension are bounded by the file (the labels, and the
+    // weights or the index of 16 bytes per 64 features) before the sizes of
+    // the other sections, which then do not overflow
+    if(header.n_classes < 2 || header.file_size > file->size() ||
+       !section_fits(header.labels_offset, header.n_classes, sizeof(double), header.file_size) ||
+       header.dimension / 4 > header.file_size || (sparse && header.n_rows > header.dimension) ||
+       !section_fits(header.weights_offset, n_rows, n_ws * weight_size, header.file_size) ||
+       !section_fits(header.index_offset, index_size, sizeof(uint64_t), header.file_size) ||
+       !section_fits(header.scales_offset, n_scales, sizeof(float), header.file_size))
+    {
+        cerr << "load_model_binary : Truncated or corrupted binary model, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Truncated binary model!");
+    }
+    const char* base = file->data();
+    const uint64_t* index = reinterpret_cast<const uint64_t*>(base + header.index_offset);
+    // the ranks must be consistent with the bitmaps to never read beyond rows
+    uint64_t rank = 0;
+    for(size_t b = 0; b < index_size; b += 2)
+    {
+        if(index[b + 1] != rank)
+        {
+            rank = ~(uint64_t)0;
+            break;
+        }
+        rank += __builtin_popcountll(index[b]);
+    }
+    if(sparse && rank != header.n_rows)
+    {
+        cerr << "load_model_binary : Corrupted index of sparse model, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Bad binary model!");
+    }
+
+    ModelUniPtr model(new Model);
+    model->n_classes = header.n_classes;
+    model->dimension = header.dimension;
+    model->bias = header.bias;
+    model->multinomial = (header.flags & kMultinomialModel) != 0;
+    const double* labels = reinterpret_cast<const double*>(base + header.labels_offset);
+    model->labels.assign(labels, labels + header.n_classes);
+    const double* weights = reinterpret_cast<const double*>(base + header.weights_offset);
+    if(sparse)
+        model->set_sparse_weights(index, weights, header.n_rows, file);
+    else
+        model->set_weights(weights, file);
+    if(weight_type != WEIGHT_DOUBLE)
+        model->set_quantized_weights(weight_type, base + header.weights_offset,
+                                     reinterpret_cast<const float*>(base + header.scales_offset), file);
+    // the weights are read at random by prediction
+    file->advise(MADV_WILLNEED);
+
+    return model;
+}
+
+} // oplin
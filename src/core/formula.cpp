@@ -15,30 +15,210 @@
 //
 // @license: See LICENSE at root directory
 #include "formula.hpp"
+#include "parallel.hpp"
+#include "math_kernel.hpp"
 namespace oplin{
 
 using std::cout;
 using std::endl;
 using std::cerr;
 
-Problem::Problem(DatasetPtr dataset, const std::vector<double>& C) : dataset_(dataset)
+Problem::Problem(DatasetPtr dataset, const std::vector<double>& C) : dataset_(dataset), n_threads_(1)
 {
     // use swap trick
     std::vector<double>(C).swap(C_);
     regularizer_ = NULL;
 }
 
+// a thread should take at least this number of non-zeros
+static const size_t kMinNnzPerThread = 1 << 16;
+
+/**
+ * Number of weights, which is the dimension of dataset by default
+ */
+size_t
+Problem::n_weights() const
+{
+    return dataset_->dimension;
+}
+
+/**
+ * Set number of threads and partition the samples for threads
+ *
+ * @param n_threads number of threads, 0 for all cores
+ */
+void
+Problem::set_n_threads(size_t n_threads)
+{
+    n_threads_ = n_threads;
+    const SpColMatrixMap& X = *(dataset_->X);
+    // small datasets are not worth the threads
+    size_t n_parts = std::min(resolve_n_threads(n_threads), (size_t)X.nonZeros() / kMinNnzPerThread);
+    if(n_parts == 0) n_parts = 1;
+
+    partition_by_nnz(X.outerIndexPtr(), dataset_->n_samples, n_parts, sample_bounds_);
+    partition_evenly(n_weights(), n_parts, feature_bounds_);
+    partial_grad_.resize(n_parts);
+    for(size_t t = 1; t < n_parts; ++t)
+        partial_grad_[t].resize(n_weights());
+    partial_loss_.resize(n_parts);
+}
+
+/**
+ * Sum up the partial losses in the order of threads
+ */
+double
+Problem::sum_partial_loss()
+{
+    double f = partial_loss_[0];
+    for(size_t t = 1; t < partial_loss_.size(); ++t)
+        f += partial_loss_[t];
+    return f;
+}
+
+/**
+ * Add the partial gradients of threads to grad, which holds the partial
+ * gradient of thread 0.
+ *
+ * @param grad gradient
+ */
+void
+Problem::reduce_partial_grad(Eigen::Ref<ColVector> grad)
+{
+    if(partial_grad_.size() == 1)
+        return;
+    parallel_for(feature_bounds_, [&](size_t, size_t begin, size_t end)
+    {
+        for(size_t t = 1; t < partial_grad_.size(); ++t)
+            grad.segment(begin, end - begin) += partial_grad_[t].segment(begin, end - begin);
+    });
+}
+
+/**
+ * Compute the loss and the gradient (without regularization term) at
+ * the same point. Problems should override this if both can be computed
+ * in one pass over the dataset.
+ *
+ * @param w    weights
+ * @param grad gradient output
+ *
+ * @return loss value
+ */
+double
+Problem::loss_and_gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
+{
+    double f = loss(w);
+    gradient(w, grad);
+    return f;
+}
+
 void
 Problem::regularized_gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
 {
     if(regularizer_) regularizer_->gradient(w,grad);
 }
 
-void
+/**
+ * Move weights along search direction
+ *
+ * @param new_w output weights
+ * @param w     weights
+ * @param p     search direction
+ * @param alpha step size
+ *
+ * @return true if new_w is projected, i.e. not exactly w + alpha * p
+ */
+bool
 Problem::update_weights(Eigen::Ref<ColVector> new_w, const Eigen::Ref<const ColVector>& w,
                                 const Eigen::Ref<const ColVector>& p, const double& alpha)
 {
     new_w.noalias() = w + alpha * p;
+    return false;
+}
+
+/**
+ * Prepare the directional evaluation along w + alpha * p. Problems
+ * which can evaluate loss of any alpha cheaper than loss() after this
+ * should override both init_direction and directional_loss.
+ *
+ * @param w weights
+ * @param p search direction
+ *
+ * @return true if directional evaluation is supported
+ */
+bool
+Problem::init_direction(const Eigen::Ref<const ColVector>& w, const Eigen::Ref<const ColVector>& p)
+{
+    return false;
+}
+
+/**
+ * Loss at new_w = w + alpha * p, where w and p are given by last
+ * init_direction call.
+ *
+ * @param new_w weights w + alpha * p
+ * @param alpha step size
+ *
+ * @return loss value
+ */
+double
+Problem::directional_loss(const Eigen::Ref<const ColVector>& new_w, const double& alpha)
+{
+    return loss(new_w);
+}
+
+/**
+ * Prepare Hessian-vector products, which are evaluated at the point of
+ * the last gradient evaluation after this call. Problems supporting
+ * second order solvers should override this and hessian_vector.
+ *
+ * @return true if Hessian-vector product is supported
+ */
+bool
+Problem::init_hessian()
+{
+    return false;
+}
+
+/**
+ * Compute the Hessian-vector product of loss (without regularization
+ * term)
+ *
+ * @param w  weights of the last gradient evaluation
+ * @param v  vector to multiply
+ * @param Hv output product
+ */
+void
+Problem::hessian_vector(const Eigen::Ref<const ColVector>& w, const Eigen::Ref<const ColVector>& v,
+                        Eigen::Ref<ColVector> Hv)
+{
+    cerr << "Problem::hessian_vector : Hessian-vector product is not supported by the problem, "
+         << __FILE__ << "," << __LINE__ << endl;
+    throw(std::runtime_error("Hessian-vector product not supported!"));
+}
+
+void
+Problem::regularized_hessian_vector(const Eigen::Ref<const ColVector>& w,
+                                    const Eigen::Ref<const ColVector>& v, Eigen::Ref<ColVector> Hv)
+{
+    if(regularizer_) regularizer_->hessian_vector(w, v, Hv);
+}
+
+/**
+ * Derivative of the loss of sample i (without regularization term) on
+ * its decision value w^T x_i, for stochastic solvers
+ *
+ * @param i sample index
+ * @param z decision value w^T x_i
+ *
+ * @return derivative
+ */
+double
+Problem::sample_derivative(size_t i, double z)
+{
+    cerr << "Problem::sample_derivative : stochastic gradient is not supported by the problem, "
+         << __FILE__ << "," << __LINE__ << endl;
+    throw(std::runtime_error("Stochastic gradient not supported!"));
 }
 
 double
@@ -77,6 +257,15 @@ L1_Regularizer::gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVec
     }
 }
 
+/**
+ * L1 norm is piecewise linear, its Hessian is zero wherever defined
+ */
+void
+L1_Regularizer::hessian_vector(const Eigen::Ref<const ColVector>& w, const Eigen::Ref<const ColVector>& v,
+                               Eigen::Ref<ColVector> Hv)
+{
+}
+
 double
 L2_Regularizer::loss(const Eigen::Ref<const ColVector>& w)
 {
@@ -89,15 +278,73 @@ L2_Regularizer::gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVec
     grad.noalias() += w;
 }
 
+void
+L2_Regularizer::hessian_vector(const Eigen::Ref<const ColVector>& w, const Eigen::Ref<const ColVector>& v,
+                               Eigen::Ref<ColVector> Hv)
+{
+    Hv.noalias() += v;
+}
+
+/**
+ * Prevent weights from moving outside the orthants of last weights, as
+ * required by L1-regularized line search
+ *
+ * @param new_w weights to project
+ * @param w     last weights
+ *
+ * @return true if any weight is projected
+ */
+static bool project_orthant(Eigen::Ref<ColVector> new_w, const Eigen::Ref<const ColVector>& w)
+{
+    bool projected = false;
+    for(int i = 0; i < new_w.rows(); ++i)
+    {
+        // check same sign
+        if(new_w(i) * w(i) < 0 )
+        {
+            new_w(i) = 0.0;
+            projected = true;
+        }
+    }
+    return projected;
+}
+
 /*********************************************************************
  *                                                 Logistic Regression
  *********************************************************************/
+// samples per block of fused loss and gradient, small enough to keep the
+// columns of a block in cache between w^T X and X z
+static const size_t kSampleBlock = 256;
+
 LR_Problem::LR_Problem(DatasetPtr dataset, const std::vector<double>& C) : Problem(dataset, C)
 {
     z_ = ColVector(dataset->n_samples, 1);
+    set_n_threads(n_threads_);
 }
 LR_Problem::~LR_Problem(){}
 
+/**
+ * Update the Hessian diagonal of samples [begin, end) from the gradient
+ * coefficients d_i = C_i * (sigmoid_i - 1) * y_i in z_, as
+ * D_ii = C_i * sigmoid_i * (1 - sigmoid_i) = -q_i * (1 + q_i / C_i) with
+ * q_i = d_i * y_i. Nothing is done before init_hessian.
+ *
+ * @param begin first sample
+ * @param end   past the last sample
+ */
+void
+LR_Problem::update_hessian_diag(size_t begin, size_t end)
+{
+    if(D_.size() == 0)
+        return;
+    const std::vector<double>& y = dataset_->y;
+    for(size_t i = begin; i < end; ++i)
+    {
+        const double q = z_(i) * y[i];
+        D_(i) = C_[i] > 0 ? -q * (1 + q / C_[i]) : 0;
+    }
+}
+
 /**
  * Compute the loss functionn
  *
@@ -107,19 +354,30 @@ LR_Problem::~LR_Problem(){}
 double
 LR_Problem::loss(const Eigen::Ref<const ColVector>& w)
 {
-
-    double f = regularizer_? regularizer_->loss(w):0;
-
     const std::vector<double>& y = dataset_->y;
+    const SpColMatrixMap& X = *(dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const double* w_data = w.data();
 
-    // W^T X
-    z_.noalias() = w.transpose() * (*(dataset_->X));
-    // std::cout << z_.sum() << std::endl;
-    // loss function : negative log likelihood
-    for(size_t i = 0; i < dataset_->n_samples; ++i)
-        f += C_[i] * log( 1 + exp(-y[i] * z_(i) ) );
+    partial_loss_[0] = regularizer_? regularizer_->loss(w):0;
+    parallel_for(sample_bounds_, [&](size_t t, size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            // W^T X
+            double z = 0;
+            for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+                z += values[k] * w_data[inner[k]];
+            z_(i) = z;
+        }
+        // loss function : negative log likelihood
+        double f = logistic_loss(z_.data() + begin, &y[begin], &C_[begin], end - begin);
+        partial_loss_[t] = t == 0 ? partial_loss_[0] + f : f;
+    });
 
-    return f;
+    return sum_partial_loss();
 }
 
 
@@ -132,17 +390,221 @@ void
 LR_Problem::gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
 {
     const std::vector<double>& y = dataset_->y;
+    const SpColMatrixMap& X = *(dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+
+    parallel_for(sample_bounds_, [&](size_t t, size_t begin, size_t end)
+    {
+        double* g_data = t == 0 ? grad.data() : partial_grad_[t].data();
+        std::fill(g_data, g_data + dataset_->dimension, 0.);
+        // C * (h_w(y_i,x_i) - 1) * y[i], h_w(y_i,x_i) is sigmoid function
+        double* z_data = z_.data();
+        logistic_loss_grad(z_data + begin, &y[begin], &C_[begin], z_data + begin, end - begin);
+        update_hessian_diag(begin, end);
+        // X z
+        for(size_t i = begin; i < end; ++i)
+        {
+            for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+                g_data[inner[k]] += values[k] * z_data[i];
+        }
+    });
+    reduce_partial_grad(grad);
+}
+
+/**
+ * Compute the loss and the gradient in one pass over the columns
+ * (samples) of X. Samples are processed by blocks, the columns of a block
+ * are read twice while they are still in cache, once for w^T x_i and once
+ * for adding their contributions to gradient.
+ *
+ * @param w    weights
+ * @param grad gradient output
+ *
+ * @return loss value
+ */
+double
+LR_Problem::loss_and_gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
+{
+    const std::vector<double>& y = dataset_->y;
+    const SpColMatrixMap& X = *(dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const double* w_data = w.data();
+
+    partial_loss_[0] = regularizer_? regularizer_->loss(w):0;
+    parallel_for(sample_bounds_, [&](size_t t, size_t begin, size_t end)
+    {
+        double* g_data = t == 0 ? grad.data() : partial_grad_[t].data();
+        std::fill(g_data, g_data + dataset_->dimension, 0.);
+        double* z_data = z_.data();
+        double f = t == 0 ? partial_loss_[0] : 0;
+        for(size_t block = begin; block < end; block += kSampleBlock)
+        {
+            size_t block_end = std::min(block + kSampleBlock, end);
+            // w^T x_i
+            for(size_t i = block; i < block_end; ++i)
+            {
+                double z = 0;
+                for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+                    z += values[k] * w_data[inner[k]];
+                z_data[i] = z;
+            }
+            // loss function : negative log likelihood and
+            // C * (h_w(y_i,x_i) - 1) * y[i]
+            f += logistic_loss_grad(z_data + block, &y[block], &C_[block],
+                                    z_data + block, block_end - block);
+            update_hessian_diag(block, block_end);
+            for(size_t i = block; i < block_end; ++i)
+            {
+                for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+                    g_data[inner[k]] += values[k] * z_data[i];
+            }
+        }
+        partial_loss_[t] = f;
+    });
+    reduce_partial_grad(grad);
+
+    return sum_partial_loss();
+}
+
+/**
+ * Cache w^T X and p^T X in one pass over X, so that the loss of any step
+ * w + alpha * p only costs O(n_samples) as
+ * (w + alpha * p)^T X = w^T X + alpha * p^T X.
+ *
+ * @param w weights
+ * @param p search direction
+ *
+ * @return true
+ */
+bool
+LR_Problem::init_direction(const Eigen::Ref<const ColVector>& w, const Eigen::Ref<const ColVector>& p)
+{
+    const SpColMatrixMap& X = *(dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const double* w_data = w.data();
+    const double* p_data = p.data();
+
+    wTX_.resize(dataset_->n_samples);
+    pTX_.resize(dataset_->n_samples);
+    parallel_for(sample_bounds_, [&](size_t, size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            double wTx = 0, pTx = 0;
+            for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+            {
+                wTx += values[k] * w_data[inner[k]];
+                pTx += values[k] * p_data[inner[k]];
+            }
+            wTX_(i) = wTx;
+            pTX_(i) = pTx;
+        }
+    });
+    return true;
+}
+
+/**
+ * Compute the loss at new_w = w + alpha * p with cached w^T X and p^T X
+ *
+ * @param new_w weights w + alpha * p
+ * @param alpha step size
+ *
+ * @return loss value
+ */
+double
+LR_Problem::directional_loss(const Eigen::Ref<const ColVector>& new_w, const double& alpha)
+{
+    const std::vector<double>& y = dataset_->y;
+
+    partial_loss_[0] = regularizer_? regularizer_->loss(new_w):0;
+    parallel_for(sample_bounds_, [&](size_t t, size_t begin, size_t end)
+    {
+        // (w + alpha * p)^T X
+        z_.segment(begin, end - begin) = wTX_.segment(begin, end - begin) + alpha * pTX_.segment(begin, end - begin);
+        double f = logistic_loss(z_.data() + begin, &y[begin], &C_[begin], end - begin);
+        partial_loss_[t] = t == 0 ? partial_loss_[0] + f : f;
+    });
+
+    return sum_partial_loss();
+}
+
+/**
+ * Allocate the Hessian diagonal, which is filled by the following
+ * gradient evaluations
+ *
+ * @return true
+ */
+bool
+LR_Problem::init_hessian()
+{
+    D_ = ColVector::Zero(dataset_->n_samples);
+    return true;
+}
 
-    for(size_t i = 0; i < dataset_->n_samples; ++i)
+/**
+ * Compute the Hessian-vector product X D X^T v in one pass over X, with
+ * D cached by the last gradient evaluation
+ *
+ * @param w  weights of the last gradient evaluation
+ * @param v  vector to multiply
+ * @param Hv output product
+ */
+void
+LR_Problem::hessian_vector(const Eigen::Ref<const ColVector>& w, const Eigen::Ref<const ColVector>& v,
+                           Eigen::Ref<ColVector> Hv)
+{
+    if(D_.size() == 0)
     {
-        // h_w(y_i,x_i) - sigmoid function
-        z_(i) = 1 / (1+exp(-y[i]*z_(i)));
-        // C * (h_w(y_i,x_i) - 1) * y[i]
-        z_(i) = C_[i]*(z_(i)-1)*y[i];
+        cerr << "LR_Problem::hessian_vector : init_hessian should be called before gradient evaluation, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::runtime_error("Hessian diagonal not initialized!"));
     }
+    const SpColMatrixMap& X = *(dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const double* v_data = v.data();
+
+    parallel_for(sample_bounds_, [&](size_t t, size_t begin, size_t end)
+    {
+        double* h_data = t == 0 ? Hv.data() : partial_grad_[t].data();
+        std::fill(h_data, h_data + dataset_->dimension, 0.);
+        for(size_t i = begin; i < end; ++i)
+        {
+            // D_ii * x_i^T v
+            double xTv = 0;
+            for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+                xTv += values[k] * v_data[inner[k]];
+            xTv *= D_(i);
+            for(SpColMatrix::StorageIndex k = outer[i]; k < outer[i+1]; ++k)
+                h_data[inner[k]] += values[k] * xTv;
+        }
+    });
+    reduce_partial_grad(Hv);
+}
 
-    // declare noalias here to enforce lazy evaluation for memory saving
-    grad.noalias() = *(dataset_->X) * z_;
+/**
+ * Derivative C_i * (sigmoid(y_i z) - 1) * y_i of the loss of sample i
+ *
+ * @param i sample index
+ * @param z decision value w^T x_i
+ *
+ * @return derivative
+ */
+double
+LR_Problem::sample_derivative(size_t i, double z)
+{
+    const double y = dataset_->y[i];
+    const double m = y * z;
+    // stable for any margin, see math_kernel.hpp
+    const double e = exp(-fabs(m));
+    return C_[i] * (m > 0 ? -e : -1.0) / (1 + e) * y;
 }
 
 /*********************************************************************
@@ -159,17 +621,12 @@ L1R_LR_Problem::L1R_LR_Problem(DatasetPtr dataset, const std::vector<double>& C)
     }
 }
 L1R_LR_Problem::~L1R_LR_Problem(){}
-void
+bool
 L1R_LR_Problem::update_weights(Eigen::Ref<ColVector> new_w, const Eigen::Ref<const ColVector>& w,
                                const Eigen::Ref<const ColVector>& p, const double& alpha)
 {
     new_w.noalias() = w + alpha * p;
-    // prevent moving outside orthants
-    for(size_t i = 0; i < dataset_->dimension; ++i)
-    {
-        // check same sign
-        if(new_w(i) * w(i) < 0 ) new_w(i) = 0.0;
-    }
+    return project_orthant(new_w, w);
 }
 /*********************************************************************
  *                                  L2-Regularized Logistic Regression
@@ -186,4 +643,351 @@ L2R_LR_Problem::L2R_LR_Problem(DatasetPtr dataset, const std::vector<double>& C)
 }
 L2R_LR_Problem::~L2R_LR_Problem(){}
 
+/*********************************************************************
+ *                                  Multinomial Logistic Regression
+ *********************************************************************/
+Multinomial_LR_Problem::Multinomial_LR_Problem(DatasetPtr dataset, const std::vector<double>& C,
+                                               size_t n_classes)
+    : Problem(dataset, C), n_classes_(n_classes)
+{
+    set_n_threads(n_threads_);
+}
+Multinomial_LR_Problem::~Multinomial_LR_Problem(){}
+
+/**
+ * Number of weights, K weights for every feature
+ */
+size_t
+Multinomial_LR_Problem::n_weights() const
+{
+    return dataset_->dimension * n_classes_;
+}
+
+/**
+ * Compute the loss and optionally the gradient in one pass over X. The K
+ * scores W^T x_i of a sample are accumulated over its non-zeros, each
+ * reads the contiguous weights of a feature, then the softmax
+ * coefficients are scattered back the same way.
+ *
+ * @param w    weights
+ * @param grad gradient output, NULL for loss only
+ *
+ * @return loss value
+ */
+double
+Multinomial_LR_Problem::evaluate(const Eigen::Ref<const ColVector>& w, double* grad)
+{
+    const std::vector<double>& y = dataset_->y;
+    const SpColMatrixMap& X = *(dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const double* w_data = w.data();
+    const size_t K = n_classes_;
+
+    partial_loss_[0] = regularizer_? regularizer_->loss(w):0;
+    parallel_for(sample_bounds_, [&](size_t t, size_t begin, size_t end)
+    {
+        double* g_data = NULL;
+        if(grad)
+        {
+            g_data = t == 0 ? grad : partial_grad_[t].data();
+            std::fill(g_data, g_data + n_weights(), 0.);
+        }
+        std::vector<double> scores(K);
+        double f = t == 0 ? partial_loss_[0] : 0;
+        for(size_t i = begin; i < end; ++i)
+        {
+            // W^T x_i
+            std::fill(scores.begin(), scores.end(), 0.);
+            for(SpColMatrix::StorageIndex p = outer[i]; p < outer[i+1]; ++p)
+            {
+                const double* w_j = w_data + inner[p] * K;
+                const double v = values[p];
+                for(size_t k = 0; k < K; ++k)
+                    scores[k] += v * w_j[k];
+            }
+            // loss function : C * (log(sum_k exp(s_k)) - s_y), shifted by
+            // the max score to avoid overflow
+            const size_t c = (size_t)y[i];
+            const double s_c = scores[c];
+            const double s_max = *std::max_element(scores.begin(), scores.end());
+            double sum = 0;
+            for(size_t k = 0; k < K; ++k)
+            {
+                scores[k] = exp(scores[k] - s_max);
+                sum += scores[k];
+            }
+            f += C_[i] * (s_max + log(sum) - s_c);
+            if(!grad)
+                continue;
+            // C * (softmax_k - 1{k == y})
+            for(size_t k = 0; k < K; ++k)
+                scores[k] *= C_[i] / sum;
+            scores[c] -= C_[i];
+            for(SpColMatrix::StorageIndex p = outer[i]; p < outer[i+1]; ++p)
+            {
+                double* g_j = g_data + inner[p] * K;
+                const double v = values[p];
+                for(size_t k = 0; k < K; ++k)
+                    g_j[k] += v * scores[k];
+            }
+        }
+        partial_loss_[t] = f;
+    });
+    if(grad)
+    {
+        Eigen::Map<ColVector> grad_map(grad, n_weights());
+        reduce_partial_grad(grad_map);
+    }
+
+    return sum_partial_loss();
+}
+
+/**
+ * Compute the loss functionn
+ *
+ * @param w weights
+ */
+double
+Multinomial_LR_Problem::loss(const Eigen::Ref<const ColVector>& w)
+{
+    return evaluate(w, NULL);
+}
+
+/**
+ * Compute the gradient, which takes a pass over X as loss does
+ *
+ * @param w    weights
+ * @param grad gradient output
+ */
+void
+Multinomial_LR_Problem::gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
+{
+    evaluate(w, grad.data());
+}
+
+/**
+ * Compute the loss and the gradient in one pass over X
+ *
+ * @param w    weights
+ * @param grad gradient output
+ *
+ * @return loss value
+ */
+double
+Multinomial_LR_Problem::loss_and_gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
+{
+    return evaluate(w, grad.data());
+}
+
+L1R_Multinomial_LR_Problem::L1R_Multinomial_LR_Problem(DatasetPtr dataset, const std::vector<double>& C,
+                                                       size_t n_classes)
+    : Multinomial_LR_Problem(dataset, C, n_classes)
+{
+    regularizer_ = std::make_shared<L1_Regularizer>();
+    if(!regularizer_)
+    {
+        cerr << "L1R_Multinomial_LR_Problem::L1R_Multinomial_LR_Problem : Failed to declare regularizer! ("
+             << __FILE__ << ", line " << __LINE__ << ")."<< endl;
+        throw(std::bad_alloc());
+    }
+}
+L1R_Multinomial_LR_Problem::~L1R_Multinomial_LR_Problem(){}
+bool
+L1R_Multinomial_LR_Problem::update_weights(Eigen::Ref<ColVector> new_w, const Eigen::Ref<const ColVector>& w,
+                                           const Eigen::Ref<const ColVector>& p, const double& alpha)
+{
+    new_w.noalias() = w + alpha * p;
+    return project_orthant(new_w, w);
+}
+
+L2R_Multinomial_LR_Problem::L2R_Multinomial_LR_Problem(DatasetPtr dataset, const std::vector<double>& C,
+                                                       size_t n_classes)
+    : Multinomial_LR_Problem(dataset, C, n_classes)
+{
+    regularizer_ = std::make_shared<L2_Regularizer>();
+    if(!regularizer_)
+    {
+        cerr << "L2R_Multinomial_LR_Problem::L2R_Multinomial_LR_Problem : Failed to declare regularizer! ("
+             << __FILE__ << ", line " << __LINE__ << ")."<< endl;
+        throw(std::bad_alloc());
+    }
+}
+L2R_Multinomial_LR_Problem::~L2R_Multinomial_LR_Problem(){}
+
+/*********************************************************************
+ *                                  Streaming Logistic Regression
+ *********************************************************************/
+Streaming_LR_Problem::Streaming_LR_Problem(DatasetPtr dataset, DatasetStreamPtr stream,
+                                           const std::vector<double>& C)
+    : Problem(dataset, C), stream_(stream)
+{
+    set_n_threads(n_threads_);
+}
+Streaming_LR_Problem::~Streaming_LR_Problem(){}
+
+/**
+ * Set number of threads, the samples are partitioned block by block
+ *
+ * @param n_threads number of threads, 0 for all cores
+ */
+void
+Streaming_LR_Problem::set_n_threads(size_t n_threads)
+{
+    n_threads_ = n_threads;
+    const size_t n_parts = resolve_n_threads(n_threads);
+    partition_evenly(n_weights(), n_parts, feature_bounds_);
+    partial_grad_.resize(n_parts);
+    for(size_t t = 1; t < n_parts; ++t)
+        partial_grad_[t].resize(n_weights());
+    partial_loss_.resize(n_parts);
+}
+
+/**
+ * Compute the loss and optionally the gradient in one pass over the
+ * blocks of stream. Threads keep their partial losses and gradients over
+ * all blocks, which are reduced once at the end.
+ *
+ * @param w    weights
+ * @param grad gradient output, NULL for loss only
+ *
+ * @return loss value
+ */
+double
+Streaming_LR_Problem::evaluate(const Eigen::Ref<const ColVector>& w, double* grad)
+{
+    const std::vector<double>& y = dataset_->y;
+    const double* w_data = w.data();
+    const size_t n_parts = partial_loss_.size();
+
+    std::fill(partial_loss_.begin(), partial_loss_.end(), 0.);
+    partial_loss_[0] = regularizer_? regularizer_->loss(w):0;
+    if(grad)
+    {
+        std::fill(grad, grad + n_weights(), 0.);
+        for(size_t t = 1; t < n_parts; ++t)
+            partial_grad_[t].setZero();
+    }
+    std::vector<size_t> bounds;
+    stream_->for_each_block([&](const DatasetBlock& block)
+    {
+        const FeatureIndex* outer = block.outer.data();
+        const FeatureIndex* inner = block.inner.data();
+        const FeatureValues values(block.values.empty() ? NULL : block.values.data());
+        if((size_t)z_.size() < block.n_samples)
+            z_.resize(block.n_samples);
+        // small blocks are not worth the threads
+        size_t n_block_parts = std::min(n_parts, block.inner.size() / kMinNnzPerThread);
+        if(n_block_parts == 0) n_block_parts = 1;
+        partition_by_nnz(outer, block.n_samples, n_block_parts, bounds);
+
+        parallel_for(bounds, [&](size_t t, size_t begin, size_t end)
+        {
+            double* z_data = z_.data();
+            for(size_t i = begin; i < end; ++i)
+            {
+                double z = 0;
+                for(FeatureIndex k = outer[i]; k < outer[i+1]; ++k)
+                    z += values[k] * w_data[inner[k]];
+                z_data[i] = z;
+            }
+            const size_t first = block.begin + begin;
+            if(!grad)
+            {
+                partial_loss_[t] += logistic_loss(z_data + begin, &y[first], &C_[first], end - begin);
+                return;
+            }
+            // C * (h_w(y_i,x_i) - 1) * y[i]
+            partial_loss_[t] += logistic_loss_grad(z_data + begin, &y[first], &C_[first],
+                                                   z_data + begin, end - begin);
+            double* g_data = t == 0 ? grad : partial_grad_[t].data();
+            for(size_t i = begin; i < end; ++i)
+            {
+                for(FeatureIndex k = outer[i]; k < outer[i+1]; ++k)
+                    g_data[inner[k]] += values[k] * z_data[i];
+            }
+        });
+    });
+    if(grad)
+    {
+        Eigen::Map<ColVector> grad_map(grad, n_weights());
+        reduce_partial_grad(grad_map);
+    }
+
+    return sum_partial_loss();
+}
+
+/**
+ * Compute the loss functionn
+ *
+ * @param w weights
+ */
+double
+Streaming_LR_Problem::loss(const Eigen::Ref<const ColVector>& w)
+{
+    return evaluate(w, NULL);
+}
+
+/**
+ * Compute the gradient, which takes a pass over the stream as loss does
+ *
+ * @param w    weights
+ * @param grad gradient output
+ */
+void
+Streaming_LR_Problem::gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
+{
+    evaluate(w, grad.data());
+}
+
+/**
+ * Compute the loss and the gradient in one pass over the stream
+ *
+ * @param w    weights
+ * @param grad gradient output
+ *
+ * @return loss value
+ */
+double
+Streaming_LR_Problem::loss_and_gradient(const Eigen::Ref<const ColVector>& w, Eigen::Ref<ColVector> grad)
+{
+    return evaluate(w, grad.data());
+}
+
+L1R_Streaming_LR_Problem::L1R_Streaming_LR_Problem(DatasetPtr dataset, DatasetStreamPtr stream,
+                                                   const std::vector<double>& C)
+    : Streaming_LR_Problem(dataset, stream, C)
+{
+    regularizer_ = std::make_shared<L1_Regularizer>();
+    if(!regularizer_)
+    {
+        cerr << "L1R_Streaming_LR_Problem::L1R_Streaming_LR_Problem : Failed to declare regularizer! ("
+             << __FILE__ << ", line " << __LINE__ << ")."<< endl;
+        throw(std::bad_alloc());
+    }
+}
+L1R_Streaming_LR_Problem::~L1R_Streaming_LR_Problem(){}
+bool
+L1R_Streaming_LR_Problem::update_weights(Eigen::Ref<ColVector> new_w, const Eigen::Ref<const ColVector>& w,
+                                         const Eigen::Ref<const ColVector>& p, const double& alpha)
+{
+    new_w.noalias() = w + alpha * p;
+    return project_orthant(new_w, w);
+}
+
+L2R_Streaming_LR_Problem::L2R_Streaming_LR_Problem(DatasetPtr dataset, DatasetStreamPtr stream,
+                                                   const std::vector<double>& C)
+    : Streaming_LR_Problem(dataset, stream, C)
+{
+    regularizer_ = std::make_shared<L2_Regularizer>();
+    if(!regularizer_)
+    {
+        cerr << "L2R_Streaming_LR_Problem::L2R_Streaming_LR_Problem : Failed to declare regularizer! ("
+             << __FILE__ << ", line " << __LINE__ << ")."<< endl;
+        throw(std::bad_alloc());
+    }
+}
+L2R_Streaming_LR_Problem::~L2R_Streaming_LR_Problem(){}
+
 } // oplin
@@ -0,0 +1,316 @@
+// FTRL-Proximal online logistic regression
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "ftrl.hpp"
+
+namespace oplin{
+
+using std::cerr;
+using std::endl;
+
+/** feature of an empty slot */
+static const size_t kNoFeature = ~(size_t)0;
+/** log2 of the initial number of slots */
+static const size_t kInitialSlotsLog2 = 10;
+
+/**
+ * @param dimension feature dimension, the features beyond are ignored
+ * @param labels    labels of classes, the first one is positive for
+ *                  binary classification
+ * @param alpha     learning rate
+ * @param beta      smoothing of learning rate, typically 1
+ * @param l1        weight of L1 regularization
+ * @param l2        weight of L2 regularization
+ */
+FTRLProximal::FTRLProximal(size_t dimension, const std::vector<double>& labels, double alpha,
+                           double beta, double l1, double l2)
+    : dimension_(dimension), n_ws_(labels.size() == 2 ? 1 : labels.size()), labels_(labels),
+      alpha_(alpha), beta_(beta), l1_(l1), l2_(l2), n_features_(0), shift_(64), direct_(false),
+      n_samples_(0), loss_(0)
+{
+    if(labels.size() < 2 || alpha <= 0 || beta < 0 || l1 < 0 || l2 < 0)
+    {
+        cerr << "FTRLProximal::FTRLProximal : at least 2 labels, alpha > 0 and non-negative "
+             << "beta, l1 and l2 are required, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::invalid_argument("Bad FTRL parameters!"));
+    }
+    rehash((size_t)1 << kInitialSlotsLog2);
+    margins_.resize(n_ws_);
+}
+
+/**
+ * Grow the hash table to stay at most half full with n more features, so
+ * their slots do not move while a sample is learned
+ *
+ * @param n number of features to insert
+ */
+void
+FTRLProximal::reserve(size_t n)
+{
+    if(direct_ || 2 * (n_features_ + n) <= features_.size())
+        return;
+    size_t n_slots = features_.size();
+    while(2 * (n_features_ + n) > n_slots)
+        n_slots *= 2;
+    rehash(n_slots);
+}
+
+/**
+ * Move the touched features to a table of n_slots slots. A table of at
+ * least dimension_ slots is indexed directly by feature instead, so the
+ * state never takes more than dimension_ slots.
+ *
+ * @param n_slots number of slots, a power of 2
+ */
+void
+FTRLProximal::rehash(size_t n_slots)
+{
+    direct_ = n_slots >= dimension_;
+    if(direct_)
+        n_slots = dimension_;
+    for(shift_ = 64; ((size_t)1 << (64 - shift_)) < n_slots; --shift_);
+    std::vector<size_t> features;
+    std::vector<FTRLAccumulator> accumulators;
+    features.swap(features_);
+    accumulators.swap(accumulators_);
+    FTRLAccumulator zero = {0, 0};
+    features_.assign(n_slots, kNoFeature);
+    accumulators_.assign(n_slots * n_ws_, zero);
+    n_features_ = 0;
+    for(size_t s = 0; s < features.size(); ++s)
+    {
+        if(features[s] == kNoFeature)
+            continue;
+        std::copy(&accumulators[s * n_ws_], &accumulators[(s + 1) * n_ws_],
+                  &accumulators_[slot(features[s], home(features[s])) * n_ws_]);
+    }
+}
+
+/**
+ * Slot of a feature in the hash table, taken with zero accumulators if the
+ * feature is new, see reserve
+ *
+ * @param feature index of feature
+ * @param s       home slot of feature
+ *
+ * @return slot of feature
+ */
+size_t
+FTRLProximal::slot(size_t feature, size_t s)
+{
+    const size_t mask = features_.size() - 1;
+    while(features_[s] != feature)
+    {
+        if(features_[s] == kNoFeature)
+        {
+            features_[s] = feature;
+            ++n_features_;
+            break;
+        }
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+/**
+ * Learn one sample: predict it with the current weights and take the
+ * FTRL-Proximal step of every weight of its features
+ *
+ * @param n_x     number of features
+ * @param feature function of k returning the k-th feature (index, value)
+ * @param cls     index of the class of sample in labels
+ * @param C       penalty of sample
+ *
+ * @return loss of sample before learning it
+ */
+template <class Feature>
+double
+FTRLProximal::update(size_t n_x, Feature feature, size_t cls, double C)
+{
+    if(w_.size() < n_x * n_ws_)
+        w_.resize(n_x * n_ws_);
+    if(slots_.size() < n_x)
+        slots_.resize(n_x);
+    reserve(n_x);
+    // the home slots of all the features are fetched together, most
+    // features are found there
+    for(size_t k = 0; k < n_x; ++k)
+    {
+        const size_t j = feature(k).first;
+        if(j >= dimension_)
+            continue;
+        slots_[k] = home(j);
+        __builtin_prefetch(&features_[slots_[k]]);
+        __builtin_prefetch(&accumulators_[slots_[k] * n_ws_]);
+    }
+    for(size_t c = 0; c < n_ws_; ++c)
+        margins_[c] = 0;
+    for(size_t k = 0; k < n_x; ++k)
+    {
+        const std::pair<size_t, double> x = feature(k);
+        if(x.first >= dimension_)
+            continue;
+        slots_[k] = slot(x.first, slots_[k]);
+        const FTRLAccumulator* a = &accumulators_[slots_[k] * n_ws_];
+        for(size_t c = 0; c < n_ws_; ++c)
+        {
+            w_[k * n_ws_ + c] = weight(a[c]);
+            margins_[c] += x.second * w_[k * n_ws_ + c];
+        }
+    }
+
+    // gradients of the loss w.r.t. the margins, kept in margins_
+    double loss = 0;
+    for(size_t c = 0; c < n_ws_; ++c)
+    {
+        const bool positive = n_ws_ == 1 ? cls == 0 : cls == c;
+        // margin of the sign of label, log(1 + exp(-s)) computed stably
+        const double s = positive ? margins_[c] : -margins_[c];
+        loss += C * (s > 0 ? log1p(exp(-s)) : -s + log1p(exp(s)));
+        const double p = 1 / (1 + exp(-margins_[c]));
+        margins_[c] = C * (p - (positive ? 1 : 0));
+    }
+
+    for(size_t k = 0; k < n_x; ++k)
+    {
+        const std::pair<size_t, double> x = feature(k);
+        if(x.first >= dimension_)
+            continue;
+        FTRLAccumulator* a = &accumulators_[slots_[k] * n_ws_];
+        for(size_t c = 0; c < n_ws_; ++c)
+        {
+            const double g = margins_[c] * x.second;
+            const double sigma = (std::sqrt(a[c].n + g * g) - std::sqrt(a[c].n)) / alpha_;
+            a[c].z += g - sigma * w_[k * n_ws_ + c];
+            a[c].n += g * g;
+        }
+    }
+    ++n_samples_;
+    loss_ += loss;
+    return loss;
+}
+
+/**
+ * Learn one sample
+ *
+ * @param x     features of sample
+ * @param n_x   number of features
+ * @param label label of sample, one of labels
+ * @param C     penalty of sample
+ *
+ * @return loss of sample before learning it
+ */
+double
+FTRLProximal::learn(const FeatureNode* x, size_t n_x, double label, double C)
+{
+    size_t cls = std::find(labels_.begin(), labels_.end(), label) - labels_.begin();
+    if(cls == labels_.size())
+    {
+        cerr << "FTRLProximal::learn : Unknown label " << label << ", "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::out_of_range("label out of range"));
+    }
+    return update(n_x, [x](size_t k){ return std::make_pair(x[k].i, x[k].v); }, cls, C);
+}
+
+/**
+ * Learn the samples of X one by one in order
+ *
+ * @param X       samples in columns
+ * @param classes index of the class of every sample in labels
+ * @param C       penalty of every sample
+ */
+void
+FTRLProximal::learn(const SpColMatrixMap& X, const size_t* classes, const double* C)
+{
+    const FeatureIndex* outer = X.outerIndexPtr();
+    const FeatureIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    for(size_t j = 0; j < (size_t)X.cols(); ++j)
+    {
+        const FeatureIndex begin = outer[j];
+        update(outer[j+1] - begin, [&](size_t k)
+        {
+            return std::make_pair((size_t)inner[begin + k], values[begin + k]);
+        }, classes[j], C[j]);
+    }
+}
+
+/**
+ * Materialize all the weights
+ *
+ * @param W output, dimension * n_ws weights in the layout of Model::W_
+ */
+void
+FTRLProximal::weights(double* W) const
+{
+    std::fill(W, W + dimension_ * n_ws_, 0.);
+    for(size_t s = 0; s < features_.size(); ++s)
+    {
+        if(features_[s] == kNoFeature)
+            continue;
+        for(size_t c = 0; c < n_ws_; ++c)
+            W[features_[s] * n_ws_ + c] = weight(accumulators_[s * n_ws_ + c]);
+    }
+}
+
+/**
+ * Export the learned model. Only the non-zero weights are materialized,
+ * the model is sparse if that takes less than half of the dense memory
+ * (see Model::compact), which is the case with L1 regularization.
+ *
+ * @return unique_ptr to model
+ */
+ModelUniPtr
+FTRLProximal::export_model() const
+{
+    ModelUniPtr model(new Model());
+    model->n_classes = labels_.size();
+    model->dimension = dimension_;
+    model->bias = -1;
+    model->labels = labels_;
+
+    // the touched features in order, the others have zero weights
+    std::vector<std::pair<size_t, size_t> > touched;
+    touched.reserve(n_features_);
+    for(size_t s = 0; s < features_.size(); ++s)
+    {
+        if(features_[s] != kNoFeature)
+            touched.push_back(std::make_pair(features_[s], s));
+    }
+    std::sort(touched.begin(), touched.end());
+
+    std::vector<uint64_t> features;
+    std::vector<double> rows;
+    std::vector<double> row(n_ws_);
+    for(size_t t = 0; t < touched.size(); ++t)
+    {
+        bool non_zero = false;
+        for(size_t c = 0; c < n_ws_; ++c)
+        {
+            row[c] = weight(accumulators_[touched[t].second * n_ws_ + c]);
+            non_zero = non_zero || row[c] != 0;
+        }
+        if(!non_zero)
+            continue;
+        features.push_back(touched[t].first);
+        rows.insert(rows.end(), row.begin(), row.end());
+    }
+    if(2 * (model->index_size() + features.size() * n_ws_) <= dimension_ * n_ws_)
+    {
+        model->set_sparse_weights(features, rows);
+        return model;
+    }
+    double* W = new double[dimension_ * n_ws_]();
+    for(size_t r = 0; r < features.size(); ++r)
+        std::copy(&rows[r * n_ws_], &rows[(r + 1) * n_ws_], &W[features[r] * n_ws_]);
+    model->set_weights(W);
+    return model;
+}
+
+} // oplin
@@ -14,6 +14,28 @@ LBFGS::LBFGS() : m_step_(10) {}
 LBFGS::LBFGS(const size_t m_step): m_step_(m_step) {}
 LBFGS::~LBFGS(){}
 
+/**
+ * Getter for the steps s_k = w_{k+1} - w_k kept, the oldest first
+ *
+ * @return the s_k of the last m steps
+ */
+const std::deque<ColVectorPtr>&
+LBFGS::get_s_list() const
+{
+    return s_list_;
+}
+/**
+ * Getter for the gradient changes y_k = grad_{k+1} - grad_k kept, the
+ * oldest first
+ *
+ * @return the y_k of the last m steps
+ */
+const std::deque<ColVectorPtr>&
+LBFGS::get_y_list() const
+{
+    return y_list_;
+}
+
 /**
  * Compute the approximate Hessian using two loop recursion
  *
@@ -134,15 +156,44 @@ LBFGS::update(ProblemPtr problem, ParamPtr param, const Eigen::Ref<const ColVect
 
 }
 
+/**
+ * Fit the curvature pairs kept from a former solve (warm start) to the
+ * number of weights. The weights appended for new features have no
+ * curvature yet, the pairs are dropped if the weights are fewer.
+ *
+ * @param n_weights number of weights
+ */
+void
+LBFGS::resize_history(size_t n_weights)
+{
+    if(s_list_.empty() || (size_t)s_list_.front()->rows() == n_weights)
+        return;
+    if((size_t)s_list_.front()->rows() > n_weights)
+    {
+        s_list_.clear();
+        y_list_.clear();
+        ro_list_.clear();
+        return;
+    }
+    for(size_t i = 0; i < s_list_.size(); ++i)
+    {
+        const size_t n = s_list_[i]->rows();
+        s_list_[i]->conservativeResize(n_weights);
+        s_list_[i]->tail(n_weights - n).setZero();
+        y_list_[i]->conservativeResize(n_weights);
+        y_list_[i]->tail(n_weights - n).setZero();
+    }
+}
+
 void
 LBFGS::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>& w)
 {
 
-    // initializations
-    loss_ = problem->loss(w);
-
+    // initializations, the curvature pairs of a former solve are kept
+    resize_history(w.rows());
+    const bool kept_history = !s_list_.empty();
     grad_ = ColVector::Zero(w.rows(),1);
-    problem->gradient(w, grad_);
+    loss_ = problem->loss_and_gradient(w, grad_);
     if(param->problem_type == 0)
     {
         steepest_grad_ = grad_;
@@ -192,6 +243,17 @@ LBFGS::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>& w)
         /// 02 - Termination Check
         rela_improve = fabs((next_loss_ - loss_) / loss_);
         VOUT("|%5d|%15.4f|%15.6f|%5d|\n",epoch_,next_loss_,rela_improve,iter);
+        // the curvature pairs kept from a former solve are of other
+        // samples, a first step stalled on them restarts from the
+        // steepest direction instead of stopping
+        if(epoch_ == 0 && kept_history && rela_improve < param->rela_tol &&
+           next_loss_ >= param->abs_tol)
+        {
+            y_list_.clear();
+            s_list_.clear();
+            ro_list_.clear();
+            continue;
+        }
         if(rela_improve < param->rela_tol || next_loss_ < param->abs_tol)
         {
             // assign next_w_ to w as return value
@@ -200,8 +262,7 @@ LBFGS::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>& w)
         }
 
         /// 03 - Update varaiables
-        problem->gradient(next_w_, next_grad_);
-
+        //     |- next_grad_ at next_w_ is computed by line search
         if(param->problem_type == 0)
         {
             steepest_grad_ = next_grad_;
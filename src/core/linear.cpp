@@ -17,7 +17,10 @@
 //
 // @license: See LICENSE at root directory
 #include "linear.hpp"
+#include "math_kernel.hpp"
+#include "binary_io.hpp"
 #include <fstream>
+#include <cmath>
 
 namespace oplin{
 using std::cout;
@@ -33,6 +36,244 @@ void VOUT(const char* fmt, ...)
     va_end(args);
 #endif
 }
+/// Owned index and rows of a sparse model
+struct SparseWeights
+{
+    std::vector<uint64_t> index;
+    std::vector<double> rows;
+};
+
+/// Owned rows of a quantized model
+struct QuantizedWeights
+{
+    std::vector<int8_t> int8_rows;
+    std::vector<uint16_t> fp16_rows;
+    std::vector<float> scales;
+    /** former storage, which holds the index of sparse model */
+    std::shared_ptr<const void> index_storage;
+};
+
+/**
+ * Convert float to IEEE half precision, rounded to nearest even. Finite
+ * values beyond the range of half are clamped to the largest half instead
+ * of becoming infinite.
+ */
+uint16_t float_to_half(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const uint32_t abs_bits = bits & 0x7fffffff;
+    // inf or nan
+    if(abs_bits >= 0x7f800000)
+        return sign | 0x7c00 | (abs_bits > 0x7f800000 ? 0x200 : 0);
+    // 65520 and above would round to inf
+    if(abs_bits >= 0x477ff000)
+        return sign | 0x7bff;
+    // below 2^-14, subnormal half of unit 2^-24
+    if(abs_bits < 0x38800000)
+    {
+        float abs_f;
+        memcpy(&abs_f, &abs_bits, sizeof(abs_f));
+        return sign | (uint16_t)lrintf(abs_f * 16777216.f);
+    }
+    // rebias the exponent and round the 13 dropped bits of mantissa
+    uint32_t h = (abs_bits - 0x38000000) >> 13;
+    const uint32_t rest = abs_bits & 0x1fff;
+    if(rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+        ++h;
+    return sign | h;
+}
+
+/**
+ * Let the model view sparse weights held by storage, see add_weights
+ *
+ * @param index   bitmap and rank of every 64 features, index_size() entries
+ * @param rows    n_ws weights of every stored feature
+ * @param n_rows  number of stored features
+ * @param storage owner of index and rows
+ */
+void
+Model::set_sparse_weights(const uint64_t* index, const double* rows, size_t n_rows,
+                          std::shared_ptr<const void> storage)
+{
+    set_weights(rows, storage);
+    index_ = index;
+    n_rows_ = n_rows;
+}
+
+/**
+ * Store the non-zero weights only, owned by the model
+ *
+ * @param features features of non-zero weights in ascending order, less
+ *                 than dimension
+ * @param rows     n_ws weights of every feature
+ */
+void
+Model::set_sparse_weights(const std::vector<uint64_t>& features, const std::vector<double>& rows)
+{
+    std::shared_ptr<SparseWeights> sparse = std::make_shared<SparseWeights>();
+    sparse->index.assign(index_size(), 0);
+    sparse->rows = rows;
+    for(size_t r = 0; r < features.size(); ++r)
+        sparse->index[2 * (features[r] >> 6)] |= (uint64_t)1 << (features[r] & 63);
+    // number of features before every block
+    uint64_t rank = 0;
+    for(size_t b = 0; b < sparse->index.size(); b += 2)
+    {
+        sparse->index[b + 1] = rank;
+        rank += __builtin_popcountll(sparse->index[b]);
+    }
+    set_sparse_weights(sparse->index.data(), sparse->rows.data(), features.size(), sparse);
+}
+
+/**
+ * Keep the non-zero weights only if it takes less than half of the dense
+ * memory, which is the case of most models trained with L1
+ * regularization. Prediction then reads the small index and rows instead
+ * of the whole dense weights.
+ *
+ * @return true if the model is sparse on return
+ */
+bool
+Model::compact()
+{
+    if(sparse() || !W_)
+        return sparse();
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+    std::vector<uint64_t> features;
+    for(size_t j = 0; j < dimension; ++j)
+    {
+        for(size_t c = 0; c < n_ws; ++c)
+        {
+            if(W_[j * n_ws + c] != 0)
+            {
+                features.push_back(j);
+                break;
+            }
+        }
+    }
+    if(2 * (index_size() + features.size() * n_ws) > dimension * n_ws)
+        return false;
+
+    std::vector<double> rows;
+    rows.reserve(features.size() * n_ws);
+    for(size_t r = 0; r < features.size(); ++r)
+        rows.insert(rows.end(), &W_[features[r] * n_ws], &W_[(features[r] + 1) * n_ws]);
+    set_sparse_weights(features, rows);
+    VOUT("sparse model : %zu of %zu features\n", features.size(), dimension);
+    return true;
+}
+
+/**
+ * Let the model view quantized rows held by storage, in the layout of
+ * the current (dense or sparse) weights, which are replaced
+ *
+ * @param type      WEIGHT_INT8 or WEIGHT_FP16
+ * @param rows      n_ws quantized weights of every row
+ * @param scales    scale of every kQuantBlock rows for WEIGHT_INT8
+ * @param storage   owner of rows and scales, and of the index of sparse
+ *                  model
+ */
+void
+Model::set_quantized_weights(int type, const void* rows, const float* scales,
+                             std::shared_ptr<const void> storage)
+{
+    if(W_ && !storage_)
+        delete [] W_;
+    W_ = NULL;
+    weight_type_ = type;
+    quantized_ = rows;
+    scales_ = type == WEIGHT_INT8 ? scales : NULL;
+    storage_ = storage;
+}
+
+/**
+ * Store the weights in int8 or fp16 to cut the memory of model by 8 or 4
+ * times, at the cost of the precision of weights. Every kQuantBlock rows
+ * of int8 share the scale of their largest absolute weight over 127, so
+ * the error of a weight is at most half of its scale. fp16 keeps about 3
+ * significant digits of every weight.
+ *
+ * @param type see WeightType, nothing is done for WEIGHT_DOUBLE
+ *
+ * @return true if the model is quantized on return
+ */
+bool
+Model::quantize(int type)
+{
+    if(quantized() || !W_ || (type != WEIGHT_INT8 && type != WEIGHT_FP16))
+        return quantized();
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+    const size_t n_weights = n_weight_rows() * n_ws;
+    std::shared_ptr<QuantizedWeights> quantized = std::make_shared<QuantizedWeights>();
+    quantized->index_storage = storage_;
+    if(type == WEIGHT_INT8)
+    {
+        quantized->int8_rows.resize(n_weights);
+        const size_t block_size = kQuantBlock * n_ws;
+        for(size_t begin = 0; begin < n_weights; begin += block_size)
+        {
+            const size_t end = std::min(begin + block_size, n_weights);
+            double max_abs = 0;
+            for(size_t k = begin; k < end; ++k)
+                max_abs = std::max(max_abs, std::fabs(W_[k]));
+            const float scale = max_abs / 127;
+            quantized->scales.push_back(scale);
+            for(size_t k = begin; k < end; ++k)
+            {
+                const long q = scale > 0 ? lrint(W_[k] / scale) : 0;
+                quantized->int8_rows[k] = (int8_t)std::max(-127L, std::min(127L, q));
+            }
+        }
+        set_quantized_weights(type, quantized->int8_rows.data(), quantized->scales.data(), quantized);
+    }
+    else
+    {
+        quantized->fp16_rows.resize(n_weights);
+        for(size_t k = 0; k < n_weights; ++k)
+            quantized->fp16_rows[k] = float_to_half(W_[k]);
+        set_quantized_weights(type, quantized->fp16_rows.data(), NULL, quantized);
+    }
+    VOUT("quantized model : %zu weights of %zu bytes\n", n_weights, weight_size());
+    return true;
+}
+
+/**
+ * Materialize all the weights, of any layout (dense or sparse, double or
+ * quantized), e.g. to start a training from them
+ *
+ * @param W output, dimension * n_ws weights in the layout of W_
+ */
+void
+Model::dense_weights(double* W) const
+{
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+    std::fill(W, W + dimension * n_ws, 0.);
+    if(!W_ && !quantized_)
+        return;
+    if(!index_)
+    {
+        for(size_t j = 0; j < dimension; ++j)
+        {
+            for(size_t c = 0; c < n_ws; ++c)
+                W[j * n_ws + c] = row_weight(j, c, n_ws);
+        }
+        return;
+    }
+    size_t row = 0;
+    for(size_t b = 0; b < index_size(); b += 2)
+    {
+        for(uint64_t bits = index_[b]; bits; bits &= bits - 1)
+        {
+            const size_t j = (b / 2) * 64 + __builtin_ctzll(bits);
+            for(size_t c = 0; c < n_ws; ++c)
+                W[j * n_ws + c] = row_weight(row, c, n_ws);
+            ++row;
+        }
+    }
+}
+
 LinearBase::LinearBase() : model_(nullptr),trained_(false) {};
 LinearBase::LinearBase(ModelUniPtr model)
 {
@@ -64,9 +305,21 @@ LinearBase::export_model()
     this->trained_ = false;
     return std::move(model_);
 }
+/**
+ * Write model to file, in text or in the binary model format (see
+ * binary_io.hpp), which is memory mapped by read_model.
+ *
+ * @param filename output file name
+ * @param binary   true to write the binary model format
+ */
 void
-LinearBase::export_model_to_file(const std::string& filename)
+LinearBase::export_model_to_file(const std::string& filename, bool binary)
 {
+    if(binary)
+    {
+        save_model_binary(*model_, filename);
+        return;
+    }
     std::ofstream outfile(filename,std::ios::out);
     outfile.precision(10);
     // this sort of error should never happen?
@@ -83,22 +336,69 @@ LinearBase::export_model_to_file(const std::string& filename)
     outfile << "\n";
     outfile << "dimension " << model_->dimension <<"\n";
     outfile << "bias " << model_->bias <<"\n";
+    // only written for softmax models to keep the format of the others
+    if(model_->multinomial)
+        outfile << "multinomial 1\n";
     // output weights
     // for binary classification only one weights trained
     size_t n_ws = model_->n_classes == 2 ? 1 : model_->n_classes;
+    if(model_->sparse())
+    {
+        // lines of 0-based feature and its weights of classes
+        outfile << "sparse_weights " << model_->n_rows_ << "\n";
+        size_t row = 0;
+        for(size_t b = 0; b < model_->index_size(); b += 2)
+        {
+            for(uint64_t bits = model_->index_[b]; bits; bits &= bits - 1)
+            {
+                outfile << (b / 2) * 64 + __builtin_ctzll(bits) << " ";
+                for(size_t j = 0; j < n_ws; ++j)
+                    outfile << model_->row_weight(row, j, n_ws) << " ";
+                outfile << "\n";
+                ++row;
+            }
+        }
+        return;
+    }
+    // quantized weights are written dequantized, the text format is double
     outfile << "weights\n";
-    double* cur_w = model_->W_;
     size_t i,j;
     for(i = 0; i < model_->dimension ; ++i)
     {
         for(j=0; j<n_ws; ++j)
-        {
-            outfile << *cur_w <<" ";
-            ++cur_w;
-        }
+            outfile << model_->row_weight(i, j, n_ws) <<" ";
         outfile << "\n";
     }
 }
+/**
+ * Train on a new chunk of samples starting from the trained model (see
+ * Parameter::warm_start), a bounded number of epochs. Called repeatedly,
+ * e.g. on the data of every day, it refines the model instead of
+ * training it again from scratch.
+ *
+ * @param dataset   new chunk of samples, of the labels of the model and
+ *                  of the same or a larger dimension
+ * @param param     parameters, NULL for the parameters of the last
+ *                  training
+ * @param max_epoch bound of param->max_epoch
+ */
+void
+LinearBase::partial_fit(const DatasetPtr dataset, const ParamPtr param, size_t max_epoch)
+{
+    const ParamPtr base = param ? param : param_;
+    if(!base)
+    {
+        cerr << "LinearBase::partial_fit : Error input, param NULL and no former training, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::invalid_argument("param not valid"));
+    }
+    ParamPtr chunk_param = std::make_shared<Parameter>(*base);
+    chunk_param->warm_start = true;
+    chunk_param->max_epoch = std::min(base->max_epoch, max_epoch);
+    train(dataset, chunk_param);
+    // the next call is bounded by its own max_epoch
+    param_ = base;
+}
 /**
  * Return a state if the model parameter is trained
  *
@@ -131,38 +431,26 @@ LinearBase::get_labels()
 }
 
 /**
- * Preprocess the dataset.
+ * Preprocess the dataset, samples are left in place and labelled by the
+ * index of their classes instead of being grouped by classes.
  *
  * @param dataset   the dataset pointer
  * @param count     count of each class
- * @param start_idx start index of each class in the rearrange group
- * @param perm_idx  permutation from index of each element
+ * @param class_idx class index of each sample
  *
  */
 void
 LinearBase::preprocess_data(const DatasetPtr dataset, std::vector<size_t>& count,
-                            std::vector<size_t>& start_idx, std::vector<size_t>& perm_idx)
+                            std::vector<size_t>& class_idx)
 {
     size_t n_samples = dataset->n_samples;
     size_t n_classes = dataset->n_classes;
-    // check if perm_idx and start are empty size
-    if(!perm_idx.empty())
-    {
-        perm_idx.clear();
-        perm_idx.reserve(n_samples);
-    }
-    if(!start_idx.empty())
-    {
-        start_idx.clear();
-        start_idx.reserve(n_classes);
-    }
     size_t i=0,j=0;
     // set all counts to 0s
     count.assign(n_classes,0);
+    class_idx.clear();
+    class_idx.reserve(n_samples);
 
-    // class index for each sample (0...n_samples)
-    std::vector<size_t> index;
-    index.reserve(n_samples);
     for(i=0; i < n_samples; ++i)
     {
         double label = dataset->y[i];
@@ -180,21 +468,8 @@ LinearBase::preprocess_data(const DatasetPtr dataset, std::vector<size_t>& count
                  << __FILE__ << "," << __LINE__ << endl;
             throw(std::out_of_range("label out of range"));
         }
-        index.push_back(j);
+        class_idx.push_back(j);
     }
-    // start from 0 index
-    start_idx.push_back(0);
-    for(i=1; i<n_classes; ++i)
-        start_idx.push_back(start_idx[i-1] + count[i-1]);
-
-    // set permute from index of each element
-    for(i=0; i< n_samples; ++i)
-        perm_idx[start_idx[index[i]]++] = i;
-
-    // reset start index
-    start_idx[0] = 0;
-    for(i=1; i<n_classes; ++i)
-        start_idx[i] = start_idx[i-1] + count[i-1];
 
     return;
 }
@@ -204,12 +479,12 @@ LinearBase::preprocess_data(const DatasetPtr dataset, std::vector<size_t>& count
  * and model weights WTx
  *
  * @param x   sparse storage of feature node of <k,v> pair
- * @param WTx matrix meaning W transpose by x
- *
- * @return label of current prediction
+ * @param n_x number of feature nodes
+ * @param WTx output of W transpose by x, n_ws entries (1 for binary
+ *            classification, else n_classes)
  */
 void
-LinearBase::predict_WTx(FeatureVector x, std::vector<double>& WTx)
+LinearBase::predict_WTx(const FeatureNode* x, size_t n_x, double* WTx) const
 {
     // no WTx valdation is need as this method is encapsulated to outside.
     //
@@ -217,57 +492,83 @@ LinearBase::predict_WTx(FeatureVector x, std::vector<double>& WTx)
     // for binary classification only one weights trained
     size_t n_ws = n_classes == 2 ? 1 : n_classes;
 
-    double* w = model_->W_;
+    const double* w = model_->W_;
     size_t i;
+    for(i=0; i<n_ws; ++i)
+        WTx[i] = 0;
     // weights for current feature dimension
-    double* cur_w;
+    const double* cur_w;
     // compute W^T x
+    if(model_->sparse() || model_->quantized())
     {
-        for(size_t n = 0; n<x.size(); ++n)
+        for(size_t n = 0; n<n_x; ++n)
+        {
+            if(x[n].i >= model_->dimension)
+                continue;
+            model_->add_weights(x[n].i, x[n].v, WTx, n_ws);
+        }
+    }
+    else
+    {
+        for(size_t n = 0; n<n_x; ++n)
         {
             cur_w = &w[(x[n].i) *n_ws];
             for(i=0; i<n_ws; ++i)
-            {
-                WTx[i] += x[n].v * (*cur_w);
-                ++cur_w;
-            }
+                WTx[i] += x[n].v * cur_w[i];
         }
     }
     // if bias term are applied
     if(model_->bias_values_)
     {
         for(i=0; i<n_ws; ++i)
-        {
             WTx[i] += model_->bias_values_[i];
-        }
     }
     return;
 
 }
 
 /**
- * Make prediction on label of current input x.
+ * Make prediction on label of current input x. The scores of classes are
+ * kept in a per thread buffer, so nothing is allocated once a thread has
+ * made its first prediction.
  *
  * @param x sparse storage of feature node of <k,v> pair
  *
  * @return label of current prediction
  */
 double
-LinearBase::predict(FeatureVector x)
+LinearBase::predict(const FeatureVector& x)
 {
-    // initialize WTx by size
-    std::vector<double> WTx(model_->n_classes);
-    predict_WTx(x, WTx);
+    static thread_local std::vector<double> WTx;
+    if(WTx.size() < model_->n_classes)
+        WTx.resize(model_->n_classes);
+    return predict(x.data(), x.size(), WTx.data());
+}
+
+/**
+ * Make prediction on label of input x with caller provided buffer, no
+ * memory is allocated.
+ *
+ * @param x      sparse storage of feature node of <k,v> pair
+ * @param n_x    number of feature nodes
+ * @param scores buffer of n_classes entries, holds W^T x on return
+ *
+ * @return label of current prediction
+ */
+double
+LinearBase::predict(const FeatureNode* x, size_t n_x, double* scores)
+{
+    predict_WTx(x, n_x, scores);
     size_t i;
     // threshold 0 for binary classification
     if(model_->n_classes==2)
-        return WTx[0] > 0 ? model_->labels[0] : model_->labels[1];
+        return scores[0] > 0 ? model_->labels[0] : model_->labels[1];
     else
     {
         size_t best_idx = 0;
         for(i=0;i<model_->n_classes;++i)
         {
-            if(WTx[i] > WTx[best_idx])
+            if(scores[i] > scores[best_idx])
                 best_idx = i;
         }
         return model_->labels[best_idx];
@@ -280,18 +581,34 @@ LinearBase::predict(FeatureVector x)
  * as a probability view.
  *
  * @param x           sparse storage of feature node of <k,v> pair
- * @param probability respected probabilities of labels
+ * @param probability respected probabilities of labels, only resized if
+ *                    its size is not n_classes
  *
  * @return label of current prediction
  */
 double
-LinearBase::predict_proba(FeatureVector x, std::vector<double>& probability)
+LinearBase::predict_proba(const FeatureVector& x, std::vector<double>& probability)
 {
+    if(probability.size() != model_->n_classes)
+        probability.resize(model_->n_classes);
+    return predict_proba(x.data(), x.size(), probability.data());
+}
 
-    // use the swap trick here. will validate the benchmark later
-    // TODO: validate swap trick here
-    std::vector<double>(model_->n_classes).swap(probability);
-    predict_WTx(x, probability);
+/**
+ * Predict the label with probability into caller provided buffer, no
+ * memory is allocated.
+ *
+ * @param x           sparse storage of feature node of <k,v> pair
+ * @param n_x         number of feature nodes
+ * @param probability buffer of n_classes entries for the probabilities
+ *                    of labels
+ *
+ * @return label of current prediction
+ */
+double
+LinearBase::predict_proba(const FeatureNode* x, size_t n_x, double* probability)
+{
+    predict_WTx(x, n_x, probability);
 
     // initialize label
     double label = 0;
@@ -307,6 +624,24 @@ LinearBase::predict_proba(FeatureVector x, std::vector<double>& probability)
     {
         size_t best_idx = 0;
         double sum = 0;
+        if(model_->multinomial)
+        {
+            // softmax, shifted by the max score to avoid overflow
+            for(i=0;i<model_->n_classes;++i)
+            {
+                if(probability[i] > probability[best_idx])
+                    best_idx = i;
+            }
+            const double max_score = probability[best_idx];
+            for(i=0;i<model_->n_classes;++i)
+            {
+                probability[i] = exp(probability[i] - max_score);
+                sum += probability[i];
+            }
+            for(i = 0; i < model_->n_classes; ++i)
+                probability[i] = probability[i] / sum;
+            return model_->labels[best_idx];
+        }
         for(i=0;i<model_->n_classes;++i)
         {
             probability[i] = 1 / (1 + exp(-probability[i]));
@@ -324,4 +659,165 @@ LinearBase::predict_proba(FeatureVector x, std::vector<double>& probability)
     return label;
 }
 
+/**
+ * Predict the labels, and optionally the probabilities, of a batch of
+ * samples. The scores of dense binary models are computed on 4 samples
+ * at a time, so the loads of weights of different samples are in flight
+ * together, and the probabilities are computed by the vectorized sigmoid
+ * kernel. Features out of the model dimension are ignored.
+ *
+ * @param X           samples in columns, rows are features
+ * @param labels      output labels, X.cols() entries
+ * @param probability if not NULL, output probabilities of labels,
+ *                    n_classes entries per sample
+ */
+void
+LinearBase::predict_batch(const SpColMatrixMap& X, double* labels, double* probability)
+{
+    const size_t n_classes = model_->n_classes;
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+    const size_t n = X.cols();
+    // the bias feature is added by bias_values_, not by X
+    const size_t n_features = model_->dimension - (model_->bias_values_ ? 1 : 0);
+    const FeatureIndex* outer = X.outerIndexPtr();
+    const FeatureIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const double* w = model_->W_;
+
+    static thread_local std::vector<double> WTx;
+    if(WTx.size() < n * n_ws)
+        WTx.resize(n * n_ws);
+    double* scores = WTx.data();
+
+    size_t j = 0;
+    if(model_->sparse() || model_->quantized())
+    {
+        // a sample at a time, the index and the quantized rows are small
+        // enough to stay in cache
+        for(; j < n; ++j)
+        {
+            double* s = scores + j * n_ws;
+            for(size_t c = 0; c < n_ws; ++c)
+                s[c] = 0;
+            for(FeatureIndex k = outer[j]; k < outer[j+1]; ++k)
+            {
+                if((size_t)inner[k] >= n_features)
+                    continue;
+                model_->add_weights(inner[k], values[k], s, n_ws);
+            }
+        }
+    }
+    else if(n_ws == 1)
+    {
+        for(; j + 4 <= n; j += 4)
+        {
+            FeatureIndex k[4], end[4];
+            double s[4];
+            FeatureIndex common = outer[j+1] - outer[j];
+            for(size_t t = 0; t < 4; ++t)
+            {
+                k[t] = outer[j+t];
+                end[t] = outer[j+t+1];
+                s[t] = 0;
+                common = std::min(common, end[t] - k[t]);
+            }
+            for(FeatureIndex m = 0; m < common; ++m)
+            {
+                for(size_t t = 0; t < 4; ++t)
+                {
+                    if((size_t)inner[k[t]] < n_features)
+                        s[t] += values[k[t]] * w[inner[k[t]]];
+                    ++k[t];
+                }
+            }
+            for(size_t t = 0; t < 4; ++t)
+            {
+                for(; k[t] < end[t]; ++k[t])
+                {
+                    if((size_t)inner[k[t]] < n_features)
+                        s[t] += values[k[t]] * w[inner[k[t]]];
+                }
+                scores[j+t] = s[t];
+            }
+        }
+    }
+    for(; j < n; ++j)
+    {
+        double* s = scores + j * n_ws;
+        for(size_t c = 0; c < n_ws; ++c)
+            s[c] = 0;
+        for(FeatureIndex k = outer[j]; k < outer[j+1]; ++k)
+        {
+            if((size_t)inner[k] >= n_features)
+                continue;
+            const double* cur_w = &w[inner[k] * n_ws];
+            const double v = values[k];
+            for(size_t c = 0; c < n_ws; ++c)
+                s[c] += v * cur_w[c];
+        }
+    }
+    if(model_->bias_values_)
+    {
+        for(j = 0; j < n; ++j)
+        {
+            for(size_t c = 0; c < n_ws; ++c)
+                scores[j * n_ws + c] += model_->bias_values_[c];
+        }
+    }
+
+    // labels by the highest score, threshold 0 for binary classification
+    for(j = 0; j < n; ++j)
+    {
+        const double* s = scores + j * n_ws;
+        if(n_ws == 1)
+            labels[j] = s[0] > 0 ? model_->labels[0] : model_->labels[1];
+        else
+            labels[j] = model_->labels[std::max_element(s, s + n_ws) - s];
+    }
+    if(!probability)
+        return;
+
+    if(n_ws == 1)
+    {
+        sigmoid(scores, scores, n);
+        for(j = 0; j < n; ++j)
+        {
+            probability[2*j] = scores[j];
+            probability[2*j+1] = 1 - scores[j];
+        }
+    }
+    else if(model_->multinomial)
+    {
+        // softmax, shifted by the max score to avoid overflow
+        for(j = 0; j < n; ++j)
+        {
+            const double* s = scores + j * n_ws;
+            double* p = probability + j * n_classes;
+            const double max_score = *std::max_element(s, s + n_ws);
+            double sum = 0;
+            for(size_t c = 0; c < n_classes; ++c)
+            {
+                p[c] = exp(s[c] - max_score);
+                sum += p[c];
+            }
+            for(size_t c = 0; c < n_classes; ++c)
+                p[c] = p[c] / sum;
+        }
+    }
+    else
+    {
+        // one-vs-rest, sum normalized sigmoid of scores
+        sigmoid(scores, probability, n * n_classes);
+        for(j = 0; j < n; ++j)
+        {
+            double* p = probability + j * n_classes;
+            double sum = 0;
+            for(size_t c = 0; c < n_classes; ++c)
+                sum += p[c];
+            for(size_t c = 0; c < n_classes; ++c)
+                p[c] = p[c] / sum;
+        }
+    }
+}
+
 } // oplin
@@ -6,6 +6,8 @@
 //
 // @license: See LICENSE at root directory
 #include "logistic.hpp"
+#include "parallel.hpp"
+#include "ftrl.hpp"
 
 namespace oplin{
 using std::cout;
@@ -24,18 +26,51 @@ LogisticRegression::train(const DatasetPtr dataset, const ParamPtr param)
 {
     // input sanity check
     // TODO : validation function on dataset
-    if(!param)
-    {
-        cerr << "LogisticRegression::train : Error input, param NULL or not valid, "
-             << __FILE__ << "," << __LINE__ << endl;
-        throw(std::invalid_argument("param not valid"));
-    }
     if(!dataset)
     {
         cerr << "LogisticRegression::train : Error input, dataset NULL or not valid, "
              << __FILE__ << "," << __LINE__ << endl;
         throw(std::invalid_argument("dataset not valid"));
     }
+    train_classes(dataset, DatasetStreamPtr(), param);
+}
+
+/**
+ * Train the coefficients on a dataset streamed from disk, only the first
+ * order batch solvers (GD and L-BFGS) and One-vs-Rest are supported.
+ *
+ * @param stream training dataset stream
+ * @param param parameters
+ *
+ */
+void
+LogisticRegression::train(const DatasetStreamPtr stream, const ParamPtr param)
+{
+    if(!stream)
+    {
+        cerr << "LogisticRegression::train : Error input, stream NULL or not valid, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::invalid_argument("stream not valid"));
+    }
+    train_classes(stream->dataset(), stream, param);
+}
+
+/**
+ * Train all classes of dataset
+ *
+ * @param dataset training dataset, of which X is not used if stream is set
+ * @param stream  stream of the features of dataset, or NULL
+ * @param param   parameters
+ */
+void
+LogisticRegression::train_classes(DatasetPtr dataset, DatasetStreamPtr stream, ParamPtr param)
+{
+    if(!param)
+    {
+        cerr << "LogisticRegression::train : Error input, param NULL or not valid, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::invalid_argument("param not valid"));
+    }
 
     size_t n_samples = dataset->n_samples;
     size_t dimension = dataset->dimension;
@@ -55,11 +90,8 @@ LogisticRegression::train(const DatasetPtr dataset, const ParamPtr param)
     model->n_classes = n_classes;
 
     std::vector<size_t> count;
-    std::vector<size_t> start_idx;
-    std::vector<size_t> perm_idx;
+    std::vector<size_t> class_idx;
     count.reserve(n_classes);
-    start_idx.reserve(n_classes);
-    perm_idx.reserve(n_samples);
 
     // adjust the label sequence to if n_classes = 2 to keep +1 label
     // in advance
@@ -71,21 +103,16 @@ LogisticRegression::train(const DatasetPtr dataset, const ParamPtr param)
     // preprocess the training dataset
     try
     {
-        preprocess_data(dataset, count, start_idx, perm_idx);
+        preprocess_data(dataset, count, class_idx);
     }
     catch(std::out_of_range& e)
     {
         throw(std::runtime_error("Preprocessing(grouping) dataset fail!"));
     }
 
-    // TODO : test the actual memory usage of following manipulations
-    // permute the instances
-    // -construct the Eigen permutation matrix
-    PermutationMatrix<Dynamic,Dynamic> perm_matrix(n_samples);
-    for(size_t i = 0; i < n_samples ;++i)
-        perm_matrix.indices()[i] = perm_idx[i];
-    // -permutation columns
-    *(dataset->X) = (*(dataset->X) * perm_matrix).eval();
+    // Samples are not permuted by classes, which would copy the whole X
+    // (or the whole mapped file), targets and penalties are assigned by
+    // class_idx of every sample instead.
 
     size_t k;
     // construct multiplier for different classes
@@ -117,39 +144,126 @@ LogisticRegression::train(const DatasetPtr dataset, const ParamPtr param)
              << __FILE__ << "," << __LINE__ << endl;
         throw(std::bad_alloc());
     }
+    const bool multinomial = n_classes > 2 && param->multi_class == MULTINOMIAL && !stream &&
+                             param->solver_type != FTRL_PROXIMAL;
+    // the initial weights, of the trained model for warm start
+    if(param->solver_type == FTRL_PROXIMAL || !warm_start(dataset, param, multinomial, W_))
+        std::fill(W_, W_ + dimension * n_ws, 0.);
+
+    // all classes learned online in one pass
+    if(param->solver_type == FTRL_PROXIMAL)
+    {
+        if(param->warm_start)
+        {
+            cerr << "LogisticRegression::train : warm start is not supported by FTRL, "
+                 << "trained from scratch, "
+                 << __FILE__ << "," << __LINE__ << endl;
+        }
+        if(n_classes > 2 && param->multi_class == MULTINOMIAL)
+        {
+            cerr << "LogisticRegression::train : Multinomial is not supported by FTRL, "
+                 << "One-vs-Rest will be used, "
+                 << __FILE__ << "," << __LINE__ << endl;
+        }
+        train_ftrl(dataset, stream, param, class_idx, penality_weights, W_);
+    }
     // handle two class classification problem
-    if(n_classes == 2)
+    else if(n_classes == 2)
     {
         // initialize weights to -0.5 ~ 0.5
         // srand((unsigned int) time(0));
         // ColVector w = ColVector::Random(dimension,1) / 2;
-        ColVector w = ColVector::Zero(dimension,1);
+        ColVector w = Map<const ColVector>(W_, dimension);
 
-        std::vector<double> C(n_samples, penality_weights[1]);
-        // rearrange labels
-        size_t pos_end = start_idx[0] + count[0];
-        for(k=0;k<pos_end;++k)
-        {
-            dataset->y[k] = +1;
+        // relabel, the first label is positive, on targets of its own to
+        // keep the labels of dataset (e.g. for a warm start on it later)
+        DatasetPtr class_dataset = std::make_shared<Dataset>();
+        class_dataset->n_samples = n_samples;
+        class_dataset->dimension = dimension;
+        class_dataset->n_classes = 2;
+        class_dataset->labels = {+1, -1};
+        class_dataset->bias = dataset->bias;
+        class_dataset->X = dataset->X;
+        class_dataset->storage = dataset->storage;
+        class_dataset->y.resize(n_samples);
 
-            // adjust the penality value for positive samples (rare)
-            C[k] = penality_weights[0];
-        }
-        for(;k<n_samples;++k)
+        std::vector<double> C(n_samples);
+        for(k=0;k<n_samples;++k)
         {
-            dataset->y[k] = -1;
+            class_dataset->y[k] = class_idx[k] == 0 ? +1 : -1;
+            C[k] = penality_weights[class_idx[k]];
         }
 
-        train_ovr(dataset, param, C, w);
+        train_ovr(class_dataset, param, C, w, solvers_[0], stream);
         for(size_t idx = 0; idx < dimension ;++idx)
             W_[idx] = w(idx);
         VOUT("#non-zeros / #features : %d / %d\n",(w.array() != 0).count(), dimension);
     }
+    // multiple class trained jointly by softmax
+    else if(multinomial)
+    {
+        // class indices as targets
+        DatasetPtr class_dataset = std::make_shared<Dataset>(*dataset);
+        std::vector<double> C(n_samples);
+        for(k=0;k<n_samples;++k)
+        {
+            class_dataset->y[k] = class_idx[k];
+            C[k] = penality_weights[class_idx[k]];
+        }
+        // the same interleaved layout as W_
+        ColVector w = Map<const ColVector>(W_, dimension * n_ws);
+        train_multinomial(class_dataset, param, C, w, solvers_[0]);
+        for(size_t idx = 0; idx < dimension * n_ws ;++idx)
+            W_[idx] = w(idx);
+        model->multinomial = true;
+    }
     // multiple class using one-vs-rest strategy
     else
     {
-        // TODO: implementation
-        cout << ">2 classes" << endl;
+        if(param->multi_class == MULTINOMIAL)
+        {
+            cerr << "LogisticRegression::train : Multinomial is not supported on streamed dataset, "
+                 << "One-vs-Rest will be used, "
+                 << __FILE__ << "," << __LINE__ << endl;
+        }
+        // The binary subproblems are trained concurrently, the threads
+        // are shared between classes first and then samples in each one.
+        // Every subproblem views the same X through a dataset of its own
+        // labels, only y and C are allocated per class.
+        const size_t n_threads = resolve_n_threads(param->n_threads);
+        const size_t n_workers = std::min(n_threads, n_classes);
+        ParamPtr class_param = std::make_shared<Parameter>(*param);
+        class_param->n_threads = std::max<size_t>(n_threads / n_workers, 1);
+
+        parallel_tasks(n_classes, n_workers, [&](size_t c)
+        {
+            DatasetPtr class_dataset = std::make_shared<Dataset>();
+            class_dataset->n_samples = n_samples;
+            class_dataset->dimension = dimension;
+            class_dataset->n_classes = 2;
+            class_dataset->labels = {+1, -1};
+            class_dataset->bias = dataset->bias;
+            class_dataset->X = dataset->X;
+            class_dataset->storage = dataset->storage;
+            class_dataset->y.assign(n_samples, -1);
+
+            std::vector<double> C(n_samples, param->base_C);
+            for(size_t i = 0; i < n_samples; ++i)
+            {
+                if(class_idx[i] != c)
+                    continue;
+                class_dataset->y[i] = +1;
+                C[i] = penality_weights[c];
+            }
+
+            ColVector w(dimension);
+            for(size_t idx = 0; idx < dimension ;++idx)
+                w(idx) = W_[idx * n_ws + c];
+            train_ovr(class_dataset, class_param, C, w, solvers_[c], stream);
+            // weights of features are interleaved by classes
+            for(size_t idx = 0; idx < dimension ;++idx)
+                W_[idx * n_ws + c] = w(idx);
+        });
     }
 
     // load parameter pointer into model, this is good practice if
@@ -167,51 +281,185 @@ LogisticRegression::train(const DatasetPtr dataset, const ParamPtr param)
             delete [] W_;
             throw(std::bad_alloc());
         }
-        // store w_0 * bias term
+        // store w_0 * bias term, the bias is the last feature
         for(size_t i = 0; i < n_ws;++i)
         {
-            bias_values[i] = dataset->bias * W_[dimension*(i+1)-1];
+            bias_values[i] = dataset->bias * W_[(dimension-1)*n_ws + i];
         }
         model->set_bias_values(bias_values);
     }
+    // most weights are 0 with L1 regularization
+    model->compact();
+    // the bias values above keep the double weight of the bias feature
+    model->quantize(param->weight_type);
     // Finally, pass model variable to member model
     this->load_model( std::move(model) );
+    param_ = param;
 }
 
 /**
- * Train One-vs-Rest
+ * Initial weights of param->warm_start, the weights of the trained model
+ * mapped to the classes and features of dataset. The weights of new
+ * features are 0, the bias term (the last feature) is kept. The solvers
+ * of the last training are kept for the same problem of the same
+ * classes, or reset.
+ *
+ * @param dataset     training dataset, the labels already ordered
+ * @param param       parameters
+ * @param multinomial true if the classes are trained jointly
+ * @param W           output, dimension * n_ws weights in the layout of
+ *                    Model::W_, untouched if not seeded
+ *
+ * @return true if W is seeded by the trained model
+ */
+bool
+LogisticRegression::warm_start(DatasetPtr dataset, ParamPtr param, bool multinomial, double* W)
+{
+    const size_t dimension = dataset->dimension;
+    const size_t n_classes = dataset->n_classes;
+    const size_t n_ws = n_classes == 2 ? 1 : n_classes;
+    const size_t n_solvers = n_classes > 2 && !multinomial ? n_classes : 1;
+    const Model* model = trained_ ? model_.get() : NULL;
+
+    // the curvature pairs of a solver are in the layout of its weights,
+    // which moves the bias term if the dimension changes
+    const bool keep_solvers = param->warm_start && model && param_ &&
+        param_->solver_type == param->solver_type && param_->problem_type == param->problem_type &&
+        model->labels == dataset->labels && model->multinomial == multinomial &&
+        solvers_.size() == n_solvers &&
+        (model->dimension == dimension || (model->bias <= 0 && dataset->bias <= 0));
+    if(!keep_solvers)
+        solvers_.assign(n_solvers, std::shared_ptr<SolverBase>());
+
+    if(!param->warm_start)
+        return false;
+    if(!model || model->n_classes != n_classes || model->multinomial != multinomial ||
+       !std::is_permutation(model->labels.begin(), model->labels.end(), dataset->labels.begin()))
+    {
+        cerr << "LogisticRegression::train : warm start needs a trained model of the labels "
+             << "of dataset and of the same multi-class strategy, trained from scratch, "
+             << __FILE__ << "," << __LINE__ << endl;
+        return false;
+    }
+
+    std::vector<double> model_W(model->dimension * n_ws);
+    model->dense_weights(model_W.data());
+    // class of the model of every class, the weights of binary model are
+    // of the first label
+    std::vector<size_t> classes(n_ws);
+    for(size_t c = 0; c < n_ws; ++c)
+    {
+        classes[c] = std::find(model->labels.begin(), model->labels.end(), dataset->labels[c]) -
+                     model->labels.begin();
+    }
+    const double sign = n_ws == 1 && classes[0] != 0 ? -1 : 1;
+    if(n_ws == 1)
+        classes[0] = 0;
+
+    const size_t model_features = model->dimension - (model->bias > 0 ? 1 : 0);
+    const size_t n_features = dimension - (dataset->bias > 0 ? 1 : 0);
+    std::fill(W, W + dimension * n_ws, 0.);
+    for(size_t j = 0; j < std::min(model_features, n_features); ++j)
+    {
+        for(size_t c = 0; c < n_ws; ++c)
+            W[j * n_ws + c] = sign * model_W[j * n_ws + classes[c]];
+    }
+    if(model->bias > 0 && dataset->bias > 0)
+    {
+        // the same bias term w * bias
+        for(size_t c = 0; c < n_ws; ++c)
+        {
+            W[(dimension - 1) * n_ws + c] = sign * model_W[(model->dimension - 1) * n_ws + classes[c]] *
+                                            model->bias / dataset->bias;
+        }
+    }
+    VOUT("warm start : %zu of %zu features from the trained model\n",
+         std::min(model_features, n_features), n_features);
+    return true;
+}
+
+/**
+ * Train all classes by FTRL-Proximal, one pass over the samples in order,
+ * see ftrl.hpp. The learning rate is param->learning_rate, the
+ * regularization is of problem type and max_epoch is not used.
  *
+ * @param dataset          training dataset
+ * @param stream           stream of the features of dataset, or NULL
+ * @param param            parameters
+ * @param class_idx        index of the class of every sample
+ * @param penality_weights penalty of every class
+ * @param W                output weights, in the layout of Model::W_
+ */
+void
+LogisticRegression::train_ftrl(DatasetPtr dataset, DatasetStreamPtr stream, ParamPtr param,
+                               const std::vector<size_t>& class_idx,
+                               const std::vector<double>& penality_weights, double* W)
+{
+    const bool l1 = param->problem_type == L1R_LR;
+    FTRLProximal ftrl(dataset->dimension, dataset->labels, param->learning_rate, 1,
+                      l1 ? 1 : 0, l1 ? 0 : 1);
+    std::vector<double> C(dataset->n_samples);
+    for(size_t i = 0; i < dataset->n_samples; ++i)
+        C[i] = penality_weights[class_idx[i]];
+    if(stream)
+    {
+        stream->for_each_block([&](const DatasetBlock& block)
+        {
+            SpColMatrixMap X(dataset->dimension, block.n_samples, block.inner.size(),
+                             block.outer.data(), block.inner.data(),
+                             block.values.empty() ? NULL : block.values.data());
+            ftrl.learn(X, &class_idx[block.begin], &C[block.begin]);
+        });
+    }
+    else
+        ftrl.learn(*(dataset->X), class_idx.data(), C.data());
+    VOUT("FTRL : %zu samples, mean loss before learning %f\n", ftrl.n_samples(), ftrl.mean_loss());
+    ftrl.weights(W);
+}
+
+/**
+ * Train all classes jointly by multinomial logistic regression
  *
+ * @param dataset dataset with class indices as targets
+ * @param param   parameters
+ * @param C       penalty of samples
+ * @param w       interleaved weights of dimension * n_classes
+ * @param solver  solver kept from the last training, or NULL to create
  */
 void
-LogisticRegression::train_ovr(DatasetPtr dataset, ParamPtr param,const std::vector<double>& C, Eigen::Ref<ColVector> w)
+LogisticRegression::train_multinomial(DatasetPtr dataset, ParamPtr param, const std::vector<double>& C,
+                                      Eigen::Ref<ColVector> w, std::shared_ptr<SolverBase>& solver)
 {
     std::shared_ptr<Problem> problem;
-    std::shared_ptr<SolverBase> solver;
     // make problem
     switch(param->problem_type)
     {
         case L1R_LR:
         {
-            problem = std::make_shared<L1R_LR_Problem>(dataset,C);
+            problem = std::make_shared<L1R_Multinomial_LR_Problem>(dataset,C,dataset->n_classes);
             break;
         }
         case L2R_LR:
         {
-            problem = std::make_shared<L2R_LR_Problem>(dataset,C);
+            problem = std::make_shared<L2R_Multinomial_LR_Problem>(dataset,C,dataset->n_classes);
             break;
         }
         default:
-            cerr << "LogisticRegression::train_ovr : invalid problem type, "
+            cerr << "LogisticRegression::train_multinomial : invalid problem type, "
                  << "Default option (L2R_LR) will be used, "
                  << __FILE__ << "," << __LINE__ << endl;
-            problem = std::make_shared<L2R_LR_Problem>(dataset,C);
+            problem = std::make_shared<L2R_Multinomial_LR_Problem>(dataset,C,dataset->n_classes);
             break;
     }
 
-    // decide solver
-    switch(param->solver_type)
+    problem->set_n_threads(param->n_threads);
+
+    // decide solver, the first order batch solvers only, unless it is
+    // kept from the last training
+    switch(solver ? -1 : param->solver_type)
     {
+        case -1:
+            break;
         case GD:
         {
             solver = std::make_shared<GradientDescent>();
@@ -223,23 +471,118 @@ LogisticRegression::train_ovr(DatasetPtr dataset, ParamPtr param,const std::vect
             break;
         }
         default:
-            cerr << "LogisticRegression::train : invalid solver type, "
+            cerr << "LogisticRegression::train_multinomial : solver not supported by multinomial, "
                  << "Default option (LBFGS) will be used, "
                  << __FILE__ << "," << __LINE__ << endl;
-            // TODO : add default initialization on solver
+            solver = std::make_shared<oplin::LBFGS>();
             break;
     }
 
     solver->solve(problem, param, w);
+}
+
+/**
+ * Train One-vs-Rest
+ *
+ * @param dataset dataset with +1/-1 targets
+ * @param param   parameters
+ * @param C       penalty of samples
+ * @param w       weights
+ * @param solver  solver kept from the last training, or NULL to create
+ * @param stream  stream of the features of dataset, or NULL
+ */
+void
+LogisticRegression::train_ovr(DatasetPtr dataset, ParamPtr param,const std::vector<double>& C, Eigen::Ref<ColVector> w,
+                              std::shared_ptr<SolverBase>& solver, DatasetStreamPtr stream)
+{
+    std::shared_ptr<Problem> problem;
+    // make problem
+    switch(param->problem_type)
+    {
+        case L1R_LR:
+        {
+            if(stream)
+                problem = std::make_shared<L1R_Streaming_LR_Problem>(dataset,stream,C);
+            else
+                problem = std::make_shared<L1R_LR_Problem>(dataset,C);
+            break;
+        }
+        case L2R_LR:
+        {
+            if(stream)
+                problem = std::make_shared<L2R_Streaming_LR_Problem>(dataset,stream,C);
+            else
+                problem = std::make_shared<L2R_LR_Problem>(dataset,C);
+            break;
+        }
+        default:
+            cerr << "LogisticRegression::train_ovr : invalid problem type, "
+                 << "Default option (L2R_LR) will be used, "
+                 << __FILE__ << "," << __LINE__ << endl;
+            if(stream)
+                problem = std::make_shared<L2R_Streaming_LR_Problem>(dataset,stream,C);
+            else
+                problem = std::make_shared<L2R_LR_Problem>(dataset,C);
+            break;
+    }
+
+    problem->set_n_threads(param->n_threads);
 
-    cout << "--------------Dev Print--------------" << endl;
-    if(w.rows()<100)
+    // decide solver, streamed dataset supports the first order batch
+    // solvers only
+    int solver_type = param->solver_type;
+    if(solver)
+        solver_type = -1;
+    else if(stream && solver_type != GD && solver_type != L_BFGS)
     {
-        cout <<"weights:"<<endl;
-        cout << w <<endl;
+        cerr << "LogisticRegression::train : solver not supported on streamed dataset, "
+             << "L-BFGS will be used, "
+             << __FILE__ << "," << __LINE__ << endl;
+        solver_type = L_BFGS;
     }
-    cout << "-----------------End-----------------" << endl;
-    return;
+    switch(solver_type)
+    {
+        // kept from the last training
+        case -1:
+            break;
+        case GD:
+        {
+            solver = std::make_shared<GradientDescent>();
+            break;
+        }
+        case SGD:
+        {
+            solver = std::make_shared<StochasticGD>();
+            break;
+        }
+        case L_BFGS:
+        {
+            solver = std::make_shared<oplin::LBFGS>();
+            break;
+        }
+        case TRON:
+        {
+            // L1 norm is not twice differentiable
+            if(param->problem_type == L1R_LR)
+            {
+                cerr << "LogisticRegression::train : TRON does not support L1-regularized problem, "
+                     << "L-BFGS will be used, "
+                     << __FILE__ << "," << __LINE__ << endl;
+                solver = std::make_shared<oplin::LBFGS>();
+                break;
+            }
+            solver = std::make_shared<class TRON>();
+            break;
+        }
+        default:
+            cerr << "LogisticRegression::train : invalid solver type, "
+                 << "Default option (LBFGS) will be used, "
+                 << __FILE__ << "," << __LINE__ << endl;
+            solver = std::make_shared<oplin::LBFGS>();
+            break;
+    }
+
+    solver->solve(problem, param, w);
 }
 
 } // oplin
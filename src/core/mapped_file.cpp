@@ -0,0 +1,75 @@
+// Read-only memory mapped file
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "mapped_file.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace oplin{
+
+using std::cerr;
+using std::endl;
+
+MappedFile::MappedFile(const std::string& filename) : data_(NULL), size_(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        cerr << "MappedFile::MappedFile : Could not open file " << filename << ", "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::runtime_error("Could not open file!"));
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0)
+    {
+        close(fd);
+        cerr << "MappedFile::MappedFile : Could not stat file " << filename << ", "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::runtime_error("Could not stat file!"));
+    }
+    size_ = st.st_size;
+    // mmap of zero length is not allowed, an empty file is simply empty
+    if(size_ > 0)
+    {
+        void* addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr == MAP_FAILED)
+        {
+            close(fd);
+            cerr << "MappedFile::MappedFile : mmap failed on file " << filename << ", "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw(std::runtime_error("mmap failed!"));
+        }
+        data_ = static_cast<const char*>(addr);
+    }
+    // the mapping keeps its own reference to the file
+    close(fd);
+}
+
+/**
+ * Give the kernel a hint on the access pattern, e.g. MADV_SEQUENTIAL
+ * for one pass scanning and MADV_WILLNEED for repeated passes.
+ *
+ * @param advice advice of madvise(2)
+ */
+void
+MappedFile::advise(int advice) const
+{
+    if(data_)
+        madvise(const_cast<char*>(data_), size_, advice);
+}
+
+MappedFile::~MappedFile()
+{
+    if(data_)
+        munmap(const_cast<char*>(data_), size_);
+}
+
+} // oplin
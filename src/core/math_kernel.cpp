@@ -0,0 +1,176 @@
+// Batched math kernels of logistic loss
+//
+// Scalar version and runtime dispatch. The instruction set specific
+// versions live in math_kernel_avx2.cpp and math_kernel_avx512.cpp, which
+// must not include Eigen or any header with inline functions: they are
+// compiled with extended instruction set flags, and an inline function
+// compiled there could be picked by the linker and run on cpus without
+// them.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "math_kernel.hpp"
+#include <cmath>
+#include <algorithm>
+
+namespace oplin{
+
+typedef double (*LogisticKernel)(const double*, const double*, const double*, double*, size_t);
+typedef void (*SigmoidKernel)(const double*, double*, size_t);
+
+static LogisticKernel kernel_of(SimdType type)
+{
+    switch(type)
+    {
+        case SIMD_AVX512:
+            return logistic_loss_avx512;
+        case SIMD_AVX2:
+            return logistic_loss_avx2;
+        default:
+            return logistic_loss_scalar;
+    }
+}
+
+static SigmoidKernel sigmoid_kernel_of(SimdType type)
+{
+    switch(type)
+    {
+        case SIMD_AVX512:
+            return sigmoid_avx512;
+        case SIMD_AVX2:
+            return sigmoid_avx2;
+        default:
+            return sigmoid_scalar;
+    }
+}
+
+static SimdType current_type = detect_simd_type();
+static LogisticKernel current_kernel = kernel_of(current_type);
+static SigmoidKernel current_sigmoid_kernel = sigmoid_kernel_of(current_type);
+
+/**
+ * Best instruction set supported by the cpu
+ */
+SimdType
+detect_simd_type()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return SIMD_AVX512;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+SimdType
+get_simd_type()
+{
+    return current_type;
+}
+
+/**
+ * Force the instruction set of kernels, mainly for benchmark. Not thread
+ * safe, call it before training. Instruction sets not supported by the
+ * cpu are ignored.
+ */
+void
+set_simd_type(SimdType type)
+{
+    if(type > detect_simd_type())
+        return;
+    current_type = type;
+    current_kernel = kernel_of(type);
+    current_sigmoid_kernel = sigmoid_kernel_of(type);
+}
+
+const char*
+simd_type_name(SimdType type)
+{
+    switch(type)
+    {
+        case SIMD_AVX512:
+            return "avx512";
+        case SIMD_AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+/**
+ * Logistic loss of margins
+ *
+ * @param z  decision values w^T x_i
+ * @param y  labels in {-1, 1}
+ * @param C  per-sample weights
+ * @param n  number of samples
+ *
+ * @return sum of C_i * log(1 + exp(-y_i z_i))
+ */
+double
+logistic_loss(const double* z, const double* y, const double* C, size_t n)
+{
+    return current_kernel(z, y, C, NULL, n);
+}
+
+/**
+ * Logistic loss and gradient coefficients of margins
+ *
+ * @param z  decision values w^T x_i
+ * @param y  labels in {-1, 1}
+ * @param C  per-sample weights
+ * @param d  output coefficients C_i * (sigmoid(y_i z_i) - 1) * y_i, may be z
+ * @param n  number of samples
+ *
+ * @return sum of C_i * log(1 + exp(-y_i z_i))
+ */
+double
+logistic_loss_grad(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    return current_kernel(z, y, C, d, n);
+}
+
+/**
+ * Sigmoid of decision values
+ *
+ * @param z  decision values w^T x_i
+ * @param p  output sigmoid(z_i), may be z
+ * @param n  number of samples
+ */
+void
+sigmoid(const double* z, double* p, size_t n)
+{
+    current_sigmoid_kernel(z, p, n);
+}
+
+double
+logistic_loss_scalar(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    double loss = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        double m = y[i] * z[i];
+        double e = std::exp(-std::fabs(m));
+        loss += C[i] * (std::max(-m, 0.0) + std::log1p(e));
+        if(d)
+            d[i] = C[i] * (m > 0 ? -e : -1.0) / (1 + e) * y[i];
+    }
+    return loss;
+}
+
+void
+sigmoid_scalar(const double* z, double* p, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        double e = std::exp(-std::fabs(z[i]));
+        p[i] = (z[i] > 0 ? 1.0 : e) / (1 + e);
+    }
+}
+
+} // oplin
@@ -0,0 +1,88 @@
+// AVX2 version of math kernels, compiled with -mavx2 -mfma
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "math_kernel.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#include "math_kernel_impl.hpp"
+
+namespace {
+
+struct PacketAVX2
+{
+    typedef __m256d type;
+    static const size_t size = 4;
+
+    static type load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, type a) { _mm256_storeu_pd(p, a); }
+    static type set1(double a) { return _mm256_set1_pd(a); }
+    static type add(type a, type b) { return _mm256_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm256_div_pd(a, b); }
+    static type fmadd(type a, type b, type c) { return _mm256_fmadd_pd(a, b, c); }
+    static type max(type a, type b) { return _mm256_max_pd(a, b); }
+    static type neg(type a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    static type abs(type a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static type round(type a)
+    {
+        return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    }
+    /** a > b ? x : y */
+    static type select_gt(type a, type b, type x, type y)
+    {
+        return _mm256_blendv_pd(y, x, _mm256_cmp_pd(a, b, _CMP_GT_OQ));
+    }
+    /** 2^n of integral n in [-1022, 1023] */
+    static type pow2(type n)
+    {
+        // the low bits of 2^52 + 1023 + n hold the biased exponent
+        __m256i bits = _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(4503599627371519.0)));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+    }
+    static double sum(type a)
+    {
+        __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+};
+
+} // namespace
+
+namespace oplin{
+
+double logistic_loss_avx2(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    return logistic_loss_impl<PacketAVX2>(z, y, C, d, n);
+}
+
+void sigmoid_avx2(const double* z, double* p, size_t n)
+{
+    sigmoid_impl<PacketAVX2>(z, p, n);
+}
+
+} // oplin
+
+#else
+
+namespace oplin{
+
+// not built for AVX2, never dispatched to
+double logistic_loss_avx2(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    return logistic_loss_scalar(z, y, C, d, n);
+}
+
+void sigmoid_avx2(const double* z, double* p, size_t n)
+{
+    sigmoid_scalar(z, p, n);
+}
+
+} // oplin
+
+#endif
@@ -0,0 +1,95 @@
+// AVX-512 version of math kernels, compiled with -mavx512f
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "math_kernel.hpp"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#include "math_kernel_impl.hpp"
+
+namespace {
+
+struct PacketAVX512
+{
+    typedef __m512d type;
+    static const size_t size = 8;
+    static const __mmask8 kAllLanes = 0xFF;
+    static const __mmask8 kHalfLanes = 0x0F;
+
+    static type load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, type a) { _mm512_storeu_pd(p, a); }
+    static type set1(double a) { return _mm512_set1_pd(a); }
+    static type add(type a, type b) { return _mm512_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm512_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm512_div_pd(a, b); }
+    static type fmadd(type a, type b, type c) { return _mm512_fmadd_pd(a, b, c); }
+    // the maskz forms of all lanes, as the plain ones of GCC merge into an
+    // undefined vector which is reported as uninitialized
+    static type max(type a, type b) { return _mm512_maskz_max_pd(kAllLanes, a, b); }
+    static type neg(type a) { return _mm512_sub_pd(_mm512_setzero_pd(), a); }
+    static type abs(type a) { return _mm512_abs_pd(a); }
+    static type round(type a)
+    {
+        return _mm512_maskz_roundscale_pd(kAllLanes, a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    }
+    /** a > b ? x : y */
+    static type select_gt(type a, type b, type x, type y)
+    {
+        return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_GT_OQ), y, x);
+    }
+    /** 2^n of integral n in [-1022, 1023] */
+    static type pow2(type n)
+    {
+        // the low bits of 2^52 + 1023 + n hold the biased exponent
+        __m512i bits = _mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(4503599627371519.0)));
+        return _mm512_castsi512_pd(_mm512_maskz_slli_epi64(kAllLanes, bits, 52));
+    }
+    /** the halves added in the order of _mm512_reduce_add_pd */
+    static double sum(type a)
+    {
+        __m256d half = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(kHalfLanes, a, 1),
+                                     _mm512_maskz_extractf64x4_pd(kHalfLanes, a, 0));
+        __m128d quarter = _mm_add_pd(_mm256_extractf128_pd(half, 1), _mm256_castpd256_pd128(half));
+        return _mm_cvtsd_f64(quarter) + _mm_cvtsd_f64(_mm_unpackhi_pd(quarter, quarter));
+    }
+};
+
+} // namespace
+
+namespace oplin{
+
+double logistic_loss_avx512(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    return logistic_loss_impl<PacketAVX512>(z, y, C, d, n);
+}
+
+void sigmoid_avx512(const double* z, double* p, size_t n)
+{
+    sigmoid_impl<PacketAVX512>(z, p, n);
+}
+
+} // oplin
+
+#else
+
+namespace oplin{
+
+// not built for AVX-512, never dispatched to
+double logistic_loss_avx512(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    return logistic_loss_scalar(z, y, C, d, n);
+}
+
+void sigmoid_avx512(const double* z, double* p, size_t n)
+{
+    sigmoid_scalar(z, p, n);
+}
+
+} // oplin
+
+#endif
@@ -0,0 +1,202 @@
+// Vectorized logistic loss kernel shared by instruction set specific
+// translation units.
+//
+// The including file defines a Packet class of the instruction set and
+// instantiates logistic_loss_impl. Everything here has internal linkage,
+// so no code compiled with extended instruction sets leaks to the other
+// translation units through the linker.
+//
+// exp and log are evaluated by polynomials with exact coefficients
+// (Taylor series of exp and the atanh series of log) after range
+// reduction, which are accurate to about one ulp in double precision.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#ifndef OPENLINEAR_MATH_KERNEL_IMPL_H_
+#define OPENLINEAR_MATH_KERNEL_IMPL_H_
+
+namespace {
+
+/**
+ * exp(x) for x <= 0, exp(x) of x < -708 is rounded up to exp(-708)
+ */
+template <class Packet>
+inline typename Packet::type exp_nonpositive(typename Packet::type x)
+{
+    typedef typename Packet::type T;
+    const double ln2_hi = 6.93145751953125e-1;
+    const double ln2_lo = 1.42860682030941723212e-6;
+
+    x = Packet::max(x, Packet::set1(-708.0));
+    // x = n * ln2 + r, |r| <= ln2 / 2
+    T n = Packet::round(Packet::mul(x, Packet::set1(1.4426950408889634074)));
+    T r = Packet::fmadd(n, Packet::set1(-ln2_hi), x);
+    r = Packet::fmadd(n, Packet::set1(-ln2_lo), r);
+
+    // Taylor series up to r^13 / 13!
+    T p = Packet::set1(1.0 / 6227020800.0);
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 479001600.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 39916800.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 3628800.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 362880.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 40320.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 5040.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 720.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 120.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 24.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0 / 6.0));
+    p = Packet::fmadd(p, r, Packet::set1(0.5));
+    p = Packet::fmadd(p, r, Packet::set1(1.0));
+    p = Packet::fmadd(p, r, Packet::set1(1.0));
+
+    // times 2^n, n is in [-1022, 0]
+    return Packet::mul(p, Packet::pow2(n));
+}
+
+/**
+ * log1p(e) for e in [0, 1]
+ */
+template <class Packet>
+inline typename Packet::type log1p_unit(typename Packet::type e)
+{
+    typedef typename Packet::type T;
+    const double ln2_hi = 6.93145751953125e-1;
+    const double ln2_lo = 1.42860682030941723212e-6;
+    const T one = Packet::set1(1.0);
+
+    // u = 1 + e is in [1, 2], c corrects the rounding error of u
+    T u = Packet::add(one, e);
+    T c = Packet::div(Packet::sub(e, Packet::sub(u, one)), u);
+
+    // u = 2^k * m, m is in [sqrt(2)/2, sqrt(2)]
+    T k = Packet::select_gt(u, Packet::set1(1.4142135623730951), one, Packet::set1(0.0));
+    T m = Packet::fmadd(k, Packet::mul(u, Packet::set1(-0.5)), u);
+
+    // log(m) = 2 * atanh(s), s = (m - 1) / (m + 1) is in [-0.172, 0.172]
+    T s = Packet::div(Packet::sub(m, one), Packet::add(m, one));
+    T s2 = Packet::mul(s, s);
+    T p = Packet::set1(1.0 / 21);
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 19));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 17));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 15));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 13));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 11));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 9));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 7));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 5));
+    p = Packet::fmadd(p, s2, Packet::set1(1.0 / 3));
+    // 2 * s * (1 + s2 * p)
+    T log_m = Packet::mul(Packet::add(s, s), Packet::fmadd(s2, p, one));
+
+    // k * ln2 + log(m) + c
+    return Packet::fmadd(k, Packet::set1(ln2_hi),
+                         Packet::add(Packet::fmadd(k, Packet::set1(ln2_lo), c), log_m));
+}
+
+/**
+ * Loss and gradient coefficients of one packet of samples
+ */
+template <class Packet, bool with_coef>
+inline typename Packet::type logistic_packet(const double* z, const double* y, const double* C,
+                                             double* d)
+{
+    typedef typename Packet::type T;
+    const T zero = Packet::set1(0.0);
+    const T one = Packet::set1(1.0);
+
+    T y_i = Packet::load(y);
+    T C_i = Packet::load(C);
+    // margin
+    T m = Packet::mul(y_i, Packet::load(z));
+    T e = exp_nonpositive<Packet>(Packet::neg(Packet::abs(m)));
+
+    // C * (max(-m, 0) + log1p(e))
+    T loss = Packet::mul(C_i, Packet::add(Packet::max(Packet::neg(m), zero), log1p_unit<Packet>(e)));
+
+    if(with_coef)
+    {
+        // C * (sigmoid(m) - 1) * y
+        T sigmoid_m1 = Packet::div(Packet::select_gt(m, zero, Packet::neg(e), Packet::neg(one)),
+                                   Packet::add(one, e));
+        Packet::store(d, Packet::mul(Packet::mul(C_i, sigmoid_m1), y_i));
+    }
+    return loss;
+}
+
+/**
+ * Sum of C_i * log(1 + exp(-y_i z_i)). If d is not NULL, gradient
+ * coefficients d_i = C_i * (sigmoid(y_i z_i) - 1) * y_i are stored too,
+ * d may be the same array as z.
+ */
+template <class Packet>
+double logistic_loss_impl(const double* z, const double* y, const double* C, double* d, size_t n)
+{
+    typedef typename Packet::type T;
+    const size_t width = Packet::size;
+    T sum = Packet::set1(0.0);
+    size_t i = 0;
+    if(d)
+    {
+        for(; i + width <= n; i += width)
+            sum = Packet::add(sum, logistic_packet<Packet, true>(z + i, y + i, C + i, d + i));
+    }
+    else
+    {
+        for(; i + width <= n; i += width)
+            sum = Packet::add(sum, logistic_packet<Packet, false>(z + i, y + i, C + i, NULL));
+    }
+    // the tail is padded with C = 0, which contributes nothing
+    if(i < n)
+    {
+        double z_tail[width], y_tail[width], C_tail[width], d_tail[width];
+        for(size_t k = 0; k < width; ++k)
+        {
+            z_tail[k] = i + k < n ? z[i + k] : 0;
+            y_tail[k] = i + k < n ? y[i + k] : 1;
+            C_tail[k] = i + k < n ? C[i + k] : 0;
+        }
+        sum = Packet::add(sum, logistic_packet<Packet, true>(z_tail, y_tail, C_tail, d_tail));
+        if(d)
+        {
+            for(size_t k = 0; i + k < n; ++k)
+                d[i + k] = d_tail[k];
+        }
+    }
+    return Packet::sum(sum);
+}
+
+/**
+ * p_i = sigmoid(z_i), p may be the same array as z
+ */
+template <class Packet>
+void sigmoid_impl(const double* z, double* p, size_t n)
+{
+    typedef typename Packet::type T;
+    const size_t width = Packet::size;
+    const T zero = Packet::set1(0.0);
+    const T one = Packet::set1(1.0);
+    size_t i = 0;
+    for(; i + width <= n; i += width)
+    {
+        T z_i = Packet::load(z + i);
+        T e = exp_nonpositive<Packet>(Packet::neg(Packet::abs(z_i)));
+        // 1 / (1 + e) if z > 0 else e / (1 + e)
+        Packet::store(p + i, Packet::div(Packet::select_gt(z_i, zero, one, e), Packet::add(one, e)));
+    }
+    if(i < n)
+    {
+        double z_tail[width], p_tail[width];
+        for(size_t k = 0; k < width; ++k)
+            z_tail[k] = i + k < n ? z[i + k] : 0;
+        sigmoid_impl<Packet>(z_tail, p_tail, width);
+        for(size_t k = 0; i + k < n; ++k)
+            p[i + k] = p_tail[k];
+    }
+}
+
+} // namespace
+
+#endif// OPENLINEAR_MATH_KERNEL_IMPL_H_
@@ -0,0 +1,124 @@
+// Model handle for concurrent serving
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "model_handle.hpp"
+#include <thread>
+#include <functional>
+
+namespace oplin{
+
+using std::cerr;
+using std::endl;
+
+const size_t ModelHandle::kMaxReaders;
+
+ModelHandle::Snapshot::Snapshot(std::atomic<uint64_t>* slot, LinearBase* model)
+    : slot_(slot), model_(model)
+{
+}
+
+ModelHandle::Snapshot::Snapshot(Snapshot&& other)
+    : slot_(other.slot_), model_(other.model_)
+{
+    other.slot_ = NULL;
+}
+
+/**
+ * Unpin the model, the reads of the model happen before the slot is
+ * seen free by publishers
+ */
+ModelHandle::Snapshot::~Snapshot()
+{
+    if(slot_)
+        slot_->store(0, std::memory_order_release);
+}
+
+/**
+ * @param model initial model, must be trained
+ */
+ModelHandle::ModelHandle(std::unique_ptr<LinearBase> model)
+    : current_(NULL), epoch_(1)
+{
+    if(!model || !model->is_trained())
+    {
+        cerr << "ModelHandle::ModelHandle : Model not trained, please train the model first! "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Model void!");
+    }
+    for(size_t i = 0; i < kMaxReaders; ++i)
+        slots_[i].epoch.store(0, std::memory_order_relaxed);
+    current_.store(model.release());
+}
+
+/**
+ * No snapshot may be pinned when the handle is destroyed
+ */
+ModelHandle::~ModelHandle()
+{
+    delete current_.load();
+}
+
+/**
+ * Pin the current model without lock. The slot is taken before the
+ * model is read, so a publisher which installs a new model after the
+ * read sees the slot taken and waits for it.
+ *
+ * @return snapshot of the current model
+ */
+ModelHandle::Snapshot
+ModelHandle::pin()
+{
+    // every thread starts looking for a free slot from the one it took
+    // last time, which is most likely free and in its cache
+    static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+    const uint64_t epoch = epoch_.load();
+    size_t i = hint % kMaxReaders;
+    for(;; i = (i + 1) % kMaxReaders)
+    {
+        uint64_t free_slot = 0;
+        if(slots_[i].epoch.load(std::memory_order_relaxed) == 0 &&
+           slots_[i].epoch.compare_exchange_strong(free_slot, epoch))
+            break;
+    }
+    hint = i;
+    return Snapshot(&slots_[i].epoch, current_.load());
+}
+
+/**
+ * Install a new model, then delete the former model once the snapshots
+ * pinned before the installation are all unpinned. Only the publisher
+ * waits, the predicting threads go on with either model meanwhile.
+ *
+ * @param model new model, must be trained
+ */
+void
+ModelHandle::publish(std::unique_ptr<LinearBase> model)
+{
+    if(!model || !model->is_trained())
+    {
+        cerr << "ModelHandle::publish : Model not trained, please train the model first! "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw std::runtime_error("Model void!");
+    }
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    std::unique_ptr<LinearBase> former(current_.exchange(model.release()));
+    // snapshots pinned from now on have at least this epoch and read the
+    // new model
+    const uint64_t epoch = ++epoch_;
+    for(size_t i = 0; i < kMaxReaders; ++i)
+    {
+        for(;;)
+        {
+            const uint64_t pinned = slots_[i].epoch.load(std::memory_order_acquire);
+            if(pinned == 0 || pinned >= epoch)
+                break;
+            std::this_thread::yield();
+        }
+    }
+}
+
+} // oplin
@@ -0,0 +1,42 @@
+// Helpers for data parallel loops
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "parallel.hpp"
+
+namespace oplin{
+
+/**
+ * Number of threads to use
+ *
+ * @param n_threads number of threads wanted, 0 for all cores
+ *
+ * @return number of threads, at least 1
+ */
+size_t
+resolve_n_threads(size_t n_threads)
+{
+    if(n_threads == 0)
+        n_threads = std::thread::hardware_concurrency();
+    return n_threads > 0 ? n_threads : 1;
+}
+
+/**
+ * Partition [0, n) into ranges of the same size
+ *
+ * @param n       size to partition
+ * @param n_parts number of ranges
+ * @param bounds  n_parts + 1 bounds, range t is [bounds[t], bounds[t+1])
+ */
+void
+partition_evenly(size_t n, size_t n_parts, std::vector<size_t>& bounds)
+{
+    bounds.resize(n_parts + 1);
+    for(size_t t = 0; t <= n_parts; ++t)
+        bounds[t] = n / n_parts * t + std::min(t, n % n_parts);
+}
+
+} // oplin
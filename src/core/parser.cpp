@@ -0,0 +1,473 @@
+// Fast libsvm format parser
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "parser.hpp"
+#include "parallel.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace oplin{
+
+using std::cerr;
+using std::endl;
+
+// chunks smaller than this are not worth a thread
+static const size_t kMinChunkSize = 1 << 16;
+
+// exact powers of ten in double precision
+static const double kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+static inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool is_delim(char c) { return is_blank(c) || c == '\n' || c == ':'; }
+
+static inline const char* skip_blank(const char* p, const char* end)
+{
+    while(p < end && is_blank(*p)) ++p;
+    return p;
+}
+
+/**
+ * Slow path of scan_double for the numbers which can not be converted
+ * exactly by the fast path (too many digits, large exponent, inf, nan).
+ * The token is copied to a null terminated buffer for strtod, so it is
+ * as accurate as std::stod or atof.
+ */
+static const char* scan_double_slow(const char* p, const char* end, double& v)
+{
+    const char* q = p;
+    while(q < end && !is_delim(*q)) ++q;
+    char buf[256];
+    std::string long_token;
+    const char* token;
+    if((size_t)(q - p) < sizeof(buf))
+    {
+        memcpy(buf, p, q - p);
+        buf[q - p] = '\0';
+        token = buf;
+    }
+    else
+    {
+        long_token.assign(p, q);
+        token = long_token.c_str();
+    }
+    char* stop;
+    v = strtod(token, &stop);
+    if(stop == token)
+        return NULL;
+    return p + (stop - token);
+}
+
+/**
+ * Scan a decimal floating point number in [p, end). Numbers with at most
+ * 19 significant digits and a small exponent are converted exactly with
+ * one multiplication (Clinger's fast path), otherwise strtod is used.
+ *
+ * @param p   start of the number
+ * @param end end of the buffer, never read beyond
+ * @param v   output value
+ *
+ * @return position after the number, NULL if no number is found
+ */
+const char*
+scan_double(const char* p, const char* end, double& v)
+{
+    const char* start = p;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int n_digits = 0;
+    int exp10 = 0;
+    bool any_digit = false;
+    bool truncated = false;
+    // integer part
+    for(; p < end && is_digit(*p); ++p)
+    {
+        any_digit = true;
+        if(n_digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            // leading zeros are not significant
+            if(mantissa) ++n_digits;
+        }
+        else
+        {
+            ++exp10;
+            truncated = true;
+        }
+    }
+    // fraction part
+    if(p < end && *p == '.')
+    {
+        for(++p; p < end && is_digit(*p); ++p)
+        {
+            any_digit = true;
+            if(n_digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa) ++n_digits;
+                --exp10;
+            }
+            else
+                truncated = true;
+        }
+    }
+    if(!any_digit)
+        return scan_double_slow(start, end, v);
+    // exponent part
+    if(p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool exp_negative = false;
+        if(q < end && (*q == '-' || *q == '+'))
+        {
+            exp_negative = (*q == '-');
+            ++q;
+        }
+        if(q < end && is_digit(*q))
+        {
+            int e = 0;
+            for(; q < end && is_digit(*q); ++q)
+                if(e < 100000) e = e * 10 + (*q - '0');
+            exp10 += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    if(truncated || mantissa > (uint64_t(1) << 53) || exp10 < -22 || exp10 > 22)
+        return scan_double_slow(start, end, v);
+
+    v = (double)mantissa;
+    if(exp10 < 0)
+        v /= kPow10[-exp10];
+    else
+        v *= kPow10[exp10];
+    if(negative) v = -v;
+    return p;
+}
+
+/**
+ * Scan a decimal integer feature index in [p, end).
+ *
+ * @return position after the number, NULL if no number is found
+ */
+const char*
+scan_index(const char* p, const char* end, long& i)
+{
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    if(p == end || !is_digit(*p))
+        return NULL;
+    long value = 0;
+    for(; p < end && is_digit(*p); ++p)
+    {
+        // saturate instead of overflow, any such index is invalid anyway
+        if(value < (1L << 48))
+            value = value * 10 + (*p - '0');
+    }
+    i = negative ? -value : value;
+    return p;
+}
+
+/**
+ * MurmurHash3 x86_32 of a byte string
+ *
+ * @param key  bytes to hash
+ * @param len  number of bytes
+ * @param seed seed of hash
+ *
+ * @return 32 bits hash
+ */
+uint32_t
+murmur_hash3(const char* key, size_t len, uint32_t seed)
+{
+    const uint32_t c1 = 0xcc9e2d51, c2 = 0x1b873593;
+    uint32_t h = seed;
+    const size_t n_blocks = len / 4;
+    for(size_t b = 0; b < n_blocks; ++b)
+    {
+        uint32_t k;
+        memcpy(&k, key + 4 * b, sizeof(k));
+        k *= c1;
+        k = (k << 15) | (k >> 17);
+        k *= c2;
+        h ^= k;
+        h = (h << 13) | (h >> 19);
+        h = h * 5 + 0xe6546b64;
+    }
+    const unsigned char* tail = reinterpret_cast<const unsigned char*>(key + 4 * n_blocks);
+    uint32_t k = 0;
+    switch(len & 3)
+    {
+    case 3: k ^= tail[2] << 16;
+    // fall through
+    case 2: k ^= tail[1] << 8;
+    // fall through
+    case 1: k ^= tail[0];
+        k *= c1;
+        k = (k << 15) | (k >> 17);
+        k *= c2;
+        h ^= k;
+    }
+    h ^= len;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * Check the settings of feature hashing, throw if they are invalid
+ */
+void
+check_hashing(const FeatureHashing& hashing)
+{
+    if(hashing.bits < 0 || hashing.bits > kMaxHashBits)
+    {
+        cerr << "check_hashing : Bits of feature hashing must be in [0, " << kMaxHashBits
+             << "], got " << hashing.bits << ", " << __FILE__ << "," << __LINE__ << endl;
+        throw std::invalid_argument("Bad bits of feature hashing!");
+    }
+}
+
+/**
+ * Scan a hashed feature "name:value" or "name" (value 1) in [p, end).
+ * The name is any token without blank and ':', which is hashed by
+ * murmur_hash3. The low bits of hash give the feature, and the highest
+ * bit gives the sign of value if hashing.signed_hash.
+ *
+ * @param p       start of the feature
+ * @param end     end of the line, never read beyond
+ * @param hashing settings of feature hashing, enabled
+ * @param feature output 0-based feature, less than hashing.dimension()
+ * @param v       output value
+ *
+ * @return position after the feature, NULL if the feature is malformed
+ */
+const char*
+scan_hashed_feature(const char* p, const char* end, const FeatureHashing& hashing,
+                    size_t& feature, double& v)
+{
+    const char* q = p;
+    while(q < end && !is_delim(*q)) ++q;
+    if(q == p)
+        return NULL;
+    const uint32_t h = murmur_hash3(p, q - p, 0);
+    feature = h & (hashing.dimension() - 1);
+    v = 1;
+    if(q < end && *q == ':')
+    {
+        q = scan_double(q + 1, end, v);
+        if(!q || (q < end && !is_blank(*q)))
+            return NULL;
+    }
+    if(hashing.signed_hash && (h >> 31))
+        v = -v;
+    return q;
+}
+
+/**
+ * Cut buffer into newline-aligned chunks of about the same size.
+ *
+ * @param data     buffer start
+ * @param size     buffer size
+ * @param n_chunks number of chunks wanted
+ * @param bounds   n_chunks + 1 chunk boundaries (offsets in buffer), chunk
+ *                 i is [bounds[i], bounds[i+1]). Some chunks may be empty.
+ */
+void
+split_chunks(const char* data, size_t size, size_t n_chunks, std::vector<size_t>& bounds)
+{
+    partition_evenly(size, n_chunks, bounds);
+    for(size_t i = 1; i < n_chunks; ++i)
+    {
+        size_t pos = std::max(bounds[i], bounds[i-1]);
+        // move to the beginning of next line
+        const char* eol = pos < size ? static_cast<const char*>(memchr(data + pos, '\n', size - pos)) : NULL;
+        bounds[i] = eol ? eol + 1 - data : size;
+    }
+}
+
+/**
+ * Sort the entries of the last column by feature index and sum up the
+ * duplicated features in their order of appearance, which is what
+ * SparseMatrix::setFromTriplets did for the former reader.
+ */
+static void
+canonicalize_last_column(ParsedChunk& chunk, std::vector<std::pair<int,double> >& buffer)
+{
+    const size_t begin = chunk.outer.back();
+    const size_t end = chunk.inner.size();
+    size_t k;
+    for(k = begin + 1; k < end; ++k)
+    {
+        if(chunk.inner[k-1] >= chunk.inner[k])
+            break;
+    }
+    // already strictly increasing, which is the common case
+    if(k >= end)
+        return;
+
+    buffer.clear();
+    for(k = begin; k < end; ++k)
+        buffer.push_back(std::make_pair(chunk.inner[k], chunk.values[k]));
+    std::stable_sort(buffer.begin(), buffer.end(),
+                     [](const std::pair<int,double>& a, const std::pair<int,double>& b)
+                     { return a.first < b.first; });
+    size_t n = begin;
+    for(k = 0; k < buffer.size(); ++k)
+    {
+        if(n > begin && chunk.inner[n-1] == buffer[k].first)
+        {
+            chunk.values[n-1] += buffer[k].second;
+            continue;
+        }
+        chunk.inner[n] = buffer[k].first;
+        chunk.values[n] = buffer[k].second;
+        ++n;
+    }
+    chunk.inner.resize(n);
+    chunk.values.resize(n);
+}
+
+/**
+ * Parse a chunk of lines in libsvm format:
+ *
+ *     label index1:value1 index2:value2 ...
+ *
+ * Each line is appended as a compressed column. Blank lines are skipped.
+ * Parsing stops at the first bad line and the reason is left in
+ * chunk.error, the bad line is chunk.n_samples + 1.
+ *
+ * @param begin   start of chunk, must be the beginning of a line
+ * @param end     end of chunk
+ * @param chunk   output
+ * @param hashing feature hashing, the features are hashed names instead
+ *                of indices if enabled
+ */
+void
+parse_libsvm_chunk(const char* begin, const char* end, ParsedChunk& chunk,
+                   const FeatureHashing& hashing)
+{
+    // only used for the lines with unsorted feature indices
+    std::vector<std::pair<int,double> > buffer;
+    const char* p = begin;
+    while(p < end)
+    {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if(!eol) eol = end;
+
+        p = skip_blank(p, eol);
+        if(p == eol)
+        {
+            p = eol + 1;
+            continue;
+        }
+
+        double label;
+        const char* q = scan_double(p, eol, label);
+        if(!q || (q < eol && !is_blank(*q)))
+        {
+            chunk.error = "Bad label";
+            return;
+        }
+        chunk.y.push_back(label);
+        chunk.classes.insert(label);
+
+        for(p = skip_blank(q, eol); p < eol; p = skip_blank(p, eol))
+        {
+            long i;
+            double v_ij;
+            if(hashing.enabled())
+            {
+                size_t feature;
+                p = scan_hashed_feature(p, eol, hashing, feature, v_ij);
+                if(!p)
+                {
+                    chunk.error = "Bad hashed feature";
+                    return;
+                }
+                chunk.inner.push_back(feature);
+                chunk.values.push_back((float)v_ij);
+                continue;
+            }
+            q = scan_index(p, eol, i);
+            if(!q || q == eol || *q != ':')
+            {
+                chunk.error = "Bad feature format";
+                return;
+            }
+            // feature dimension should be at least 1
+            if(i < 1)
+            {
+                chunk.error = "Bad dimension value " + std::to_string(i);
+                return;
+            }
+            p = scan_double(q + 1, eol, v_ij);
+            if(!p || (p < eol && !is_blank(*p)))
+            {
+                chunk.error = "Bad feature value";
+                return;
+            }
+
+            if((size_t)i > chunk.n_features)
+                chunk.n_features = i;
+            chunk.inner.push_back(i-1);
+            // values are rounded to float as always to keep the datasets
+            // identical with the former atof-to-float reading
+            chunk.values.push_back((float)v_ij);
+        }
+        // colliding hashed features of a sample are summed up as well
+        canonicalize_last_column(chunk, buffer);
+        chunk.outer.push_back(chunk.inner.size());
+        ++chunk.n_samples;
+        p = eol + 1;
+    }
+}
+
+/**
+ * Parse libsvm text in parallel.
+ *
+ * @param data      buffer start, typically a memory mapped file
+ * @param size      buffer size
+ * @param n_threads number of parsing threads, 0 for all cores
+ * @param chunks    parsed chunks in the order of the buffer
+ * @param hashing   feature hashing, see parse_libsvm_chunk
+ */
+void
+parse_libsvm(const char* data, size_t size, size_t n_threads, std::vector<ParsedChunk>& chunks,
+             const FeatureHashing& hashing)
+{
+    size_t n_chunks = std::min(resolve_n_threads(n_threads), size / kMinChunkSize);
+    if(n_chunks == 0) n_chunks = 1;
+
+    std::vector<size_t> bounds;
+    split_chunks(data, size, n_chunks, bounds);
+
+    chunks.clear();
+    chunks.resize(n_chunks);
+    parallel_for(bounds, [&](size_t t, size_t begin, size_t end)
+                 { parse_libsvm_chunk(data + begin, data + end, chunks[t], hashing); });
+}
+
+} // oplin
@@ -0,0 +1,191 @@
+// Stochastic gradient descent
+//
+// The objective sum_i C_i * loss_i(w) + R(w) is split evenly into
+// n_samples terms C_i * loss_i(w) + R(w) / n_samples, each step takes the
+// gradient of one term. The learning rate follows the schedule
+// eta_0 / (1 + eta_0 * lambda * t) of strongly convex problems, with
+// lambda = 1 / n_samples the regularization weight of a term and t the
+// number of steps taken. It is kept constant within an epoch, which makes
+// the regularization of the steps a feature missed a closed form of the
+// number of them.
+//
+// Reference:
+// Leon Bottou. Stochastic gradient descent tricks. In Neural Networks:
+// Tricks of the Trade, pages 421-436. Springer, 2012.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <cmath>
+#include <random>
+#include "solver.hpp"
+#include "parallel.hpp"
+
+namespace oplin
+{
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+StochasticGD::~StochasticGD(){}
+
+/**
+ * Apply the regularization of n_steps steps to a weight
+ *
+ * @param w_j     weight
+ * @param n_steps number of steps missed
+ * @param shrink  learning rate times regularization weight of one step
+ *                for L1, log(1 - learning rate * weight) for L2
+ * @param l1      true for L1 (truncation), false for L2 (decay)
+ */
+static inline void regularize_steps(double& w_j, size_t n_steps, const double& shrink, bool l1)
+{
+    if(n_steps == 0 || w_j == 0)
+        return;
+    if(l1)
+    {
+        // truncated towards zero, never crosses it
+        const double t = n_steps * shrink;
+        w_j = w_j > t ? w_j - t : (w_j < -t ? w_j + t : 0);
+    }
+    else
+    {
+        // (1 - learning rate * weight)^n_steps
+        w_j *= exp(n_steps * shrink);
+    }
+}
+
+// samples are prefetched this number of steps ahead
+static const size_t kPrefetchDistance = 4;
+
+/**
+ * Prefetch the column of a sample, which is at random position of X as
+ * samples are visited in random order
+ */
+static inline void prefetch_sample(const SpColMatrix::StorageIndex* outer,
+                                   const SpColMatrix::StorageIndex* inner, const FeatureScalar* values, size_t i)
+{
+    const char* begin = reinterpret_cast<const char*>(inner + outer[i]);
+    const char* end = reinterpret_cast<const char*>(inner + outer[i+1]);
+    for(; begin < end; begin += 64)
+        __builtin_prefetch(begin);
+    // binary features
+    if(!values)
+        return;
+    begin = reinterpret_cast<const char*>(values + outer[i]);
+    end = reinterpret_cast<const char*>(values + outer[i+1]);
+    for(; begin < end; begin += 64)
+        __builtin_prefetch(begin);
+}
+
+/**
+ * Solve the problem on dataset with parameters
+ *
+ * @param problem Problem instance, which supports sample_derivative
+ * @param param   Parameter instance
+ * @param w       weights for optimize
+ *
+ */
+void
+StochasticGD::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>& w)
+{
+    const SpColMatrixMap& X = *(problem->dataset_->X);
+    const SpColMatrix::StorageIndex* outer = X.outerIndexPtr();
+    const SpColMatrix::StorageIndex* inner = X.innerIndexPtr();
+    const FeatureValues values(X.valuePtr());
+    const size_t n_samples = problem->dataset_->n_samples;
+    const bool l1 = param->problem_type == L1R_LR;
+    // weight of regularization in every term
+    const double lambda = 1.0 / n_samples;
+    double* w_data = w.data();
+
+    // initializations
+    std::vector<size_t> bounds;
+    const size_t n_parts = resolve_n_threads(param->n_threads);
+    partition_evenly(n_samples, n_parts, bounds);
+    order_.resize(n_samples);
+    for(size_t i = 0; i < n_samples; ++i)
+        order_[i] = i;
+    last_step_.assign(w.rows(), 0);
+    std::mt19937 gen(0);
+
+    loss_ = problem->loss(w);
+    double rela_improve = 0;
+
+    // check if the weights already optimized
+    if(loss_ < param->abs_tol)
+    {
+        return;
+        VOUT("Already optimized weights get!");
+    }
+
+    // -- debug print
+    VOUT("\n*** To disable debug info: $ make DISABLE_DEBUG=yes ***\n");
+    VOUT("|%5s|%15s|%15s|%15s|\n","Epoch","Loss","Improve","Learning rate");
+
+    for(epoch_ = 0; epoch_ < param->max_epoch; ++epoch_)
+    {
+
+        /*** Epoch - k ***/
+        // t = epoch * n_samples
+        const double eta = param->learning_rate / (1 + param->learning_rate * epoch_);
+        const double shrink = l1 ? eta * lambda : log1p(-std::min(eta * lambda, 1.0));
+
+        /// 01 - One pass over samples in random order
+        std::shuffle(order_.begin(), order_.end(), gen);
+        // Threads take interleaved steps of a shared clock, so that a
+        // feature knows how many steps of all threads it missed. Weights
+        // and steps are read and written without lock: collisions only
+        // happen on features shared by samples of the same time, which
+        // are rare and harmless for sparse data.
+        parallel_for(bounds, [&](size_t t, size_t begin, size_t end)
+        {
+            for(size_t k = begin; k < end; ++k)
+            {
+                const size_t i = order_[k];
+                if(k + kPrefetchDistance < end)
+                    prefetch_sample(outer, inner, values.data, order_[k + kPrefetchDistance]);
+                const size_t step = (k - begin) * n_parts + t;
+                // w^T x_i with up-to-date weights
+                double z = 0;
+                for(SpColMatrix::StorageIndex p = outer[i]; p < outer[i+1]; ++p)
+                {
+                    const size_t j = inner[p];
+                    const size_t last = last_step_[j];
+                    if(step > last)
+                    {
+                        regularize_steps(w_data[j], step - last, shrink, l1);
+                        last_step_[j] = step;
+                    }
+                    z += values[p] * w_data[j];
+                }
+                const double g = eta * problem->sample_derivative(i, z);
+                for(SpColMatrix::StorageIndex p = outer[i]; p < outer[i+1]; ++p)
+                    w_data[inner[p]] -= g * values[p];
+            }
+        });
+
+        /// 02 - Regularization of the steps missed until the end of epoch
+        // the larger ranges come first (see partition_evenly), so the steps
+        // taken are exactly 0 .. n_samples - 1, one per sample
+        for(size_t j = 0; j < last_step_.size(); ++j)
+        {
+            if(n_samples > last_step_[j])
+                regularize_steps(w_data[j], n_samples - last_step_[j], shrink, l1);
+            last_step_[j] = 0;
+        }
+
+        /// 03 - Termination Check
+        next_loss_ = problem->loss(w);
+        rela_improve = fabs((next_loss_ - loss_) / loss_);
+        VOUT("|%5d|%15.4f|%15.6f|%15.6f|\n",epoch_,next_loss_,rela_improve,eta);
+        if(rela_improve < param->rela_tol || next_loss_ < param->abs_tol)
+            break;
+        loss_ = next_loss_;
+    }
+}
+
+} // oplin
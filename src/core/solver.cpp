@@ -41,18 +41,37 @@ SolverBase::backtracking_line_search(ProblemPtr problem, Eigen::Ref<ColVector>w,
     // armijo condition solved by backtracing approach
     // f(x_k + a*p_k) <= f(x_k) + c*a*Delta(f_k)^T * p_k
     size_t iter=0;
+    // with directional evaluation, each step costs O(n_samples) instead
+    // of a pass over dataset, which is prepared once backtracking starts
+    bool directional = false;
+    bool directional_step = false;
     // cout << "++++++++++p++++++++++\n" << p_ << "\n+++++++++++++++++++++"<<endl;
     while(true)
     {
         // update w with search direction(p) and step size(alpha)
-        problem->update_weights(next_w_, w, p_, alpha);
-        next_loss_ = problem->loss(next_w_);
+        const bool projected = problem->update_weights(next_w_, w, p_, alpha);
+        directional_step = directional && !projected;
+        // the first step is accepted in most epochs, so its gradient is
+        // evaluated in the same pass. Backtracking steps need loss only.
+        if(directional_step)
+            next_loss_ = problem->directional_loss(next_w_, alpha);
+        else if(iter == 0)
+            next_loss_ = problem->loss_and_gradient(next_w_, next_grad_);
+        else
+            next_loss_ = problem->loss(next_w_);
         // cout << "next_loss: " << next_loss_ << " | sufficient_desc: " << loss_+c1*dir_derivative * alpha << endl;
         if(next_loss_ <= loss_ + c1 * dir_derivative * alpha) break;
         alpha *= backoff;
         iter++;
-
+        if(iter == 1)
+            directional = problem->init_direction(w, p_);
     }
+    // loss and gradient at the accepted step, both are evaluated exactly
+    // after directional steps to avoid accumulating rounding errors
+    if(directional_step)
+        next_loss_ = problem->loss_and_gradient(next_w_, next_grad_);
+    else if(iter > 0)
+        problem->gradient(next_w_, next_grad_);
 
     return iter;
 }
@@ -91,11 +110,10 @@ GradientDescent::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>
 {
 
     // initializations
-    loss_ = problem->loss(w);
     steepest_grad_ = ColVector::Zero(w.rows(),1);
-    problem->gradient(w, steepest_grad_);
+    loss_ = problem->loss_and_gradient(w, steepest_grad_);
     problem->regularized_gradient(w, steepest_grad_);
-    // next_grad_ = ColVector::Zero(w.rows(),1);
+    next_grad_ = ColVector::Zero(w.rows(),1);
     next_loss_ = loss_;
     next_w_ = w;
     double rela_improve = 0;
@@ -139,7 +157,8 @@ GradientDescent::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>
         }
 
         /// 03 - Update varaiables
-        problem->gradient(next_w_, steepest_grad_);
+        //     |- gradient at next_w_ is computed by line search
+        steepest_grad_.swap(next_grad_);
         problem->regularized_gradient(next_w_, steepest_grad_);
         loss_ = next_loss_;
         w.swap(next_w_);
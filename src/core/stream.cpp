@@ -0,0 +1,231 @@
+// Out-of-core dataset streamed from binary dataset shards
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include "stream.hpp"
+#include <set>
+#include <thread>
+#include <exception>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace oplin{
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/**
+ * Read exactly bytes at offset of file, short reads are continued
+ */
+static void read_at(int fd, void* data, size_t bytes, uint64_t offset)
+{
+    char* p = static_cast<char*>(data);
+    while(bytes > 0)
+    {
+        ssize_t n = pread(fd, p, bytes, offset);
+        if(n <= 0)
+        {
+            cerr << "DatasetStream : Failed to read shard at offset " << offset << ", "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw(std::runtime_error("Failed to read shard!"));
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+}
+
+/**
+ * Open the shards and read their targets
+ *
+ * @param filenames  binary dataset files, in the order of samples
+ * @param block_size number of samples per block
+ */
+DatasetStream::DatasetStream(const std::vector<std::string>& filenames, size_t block_size)
+    : block_size_(std::max<size_t>(block_size, 1)), nnz_(0)
+{
+    dataset_ = std::make_shared<Dataset>();
+    dataset_->n_samples = 0;
+    dataset_->dimension = 0;
+    std::set<double> classes;
+    for(size_t s = 0; s < filenames.size(); ++s)
+    {
+        int fd = open(filenames[s].c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            cerr << "DatasetStream::DatasetStream : Could not open shard " << filenames[s] << ", "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw(std::runtime_error("Could not open file!"));
+        }
+        fds_.push_back(fd);
+        struct stat st;
+        DatasetFileHeader header;
+        if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(header))
+        {
+            cerr << "DatasetStream::DatasetStream : Not a binary dataset " << filenames[s] << ", "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw(std::runtime_error("Bad binary dataset!"));
+        }
+        read_at(fd, &header, sizeof(header), 0);
+        check_dataset_header(header, st.st_size);
+        FeatureIndex first, last;
+        read_at(fd, &first, sizeof(first), header.outer_offset);
+        read_at(fd, &last, sizeof(last), header.outer_offset + header.n_samples * sizeof(last));
+        check_dataset_outer(header, first, last);
+        if(s > 0 && (header.bias > 0) != (dataset_->bias > 0))
+        {
+            cerr << "DatasetStream::DatasetStream : Shard " << filenames[s]
+                 << " is not converted with the same bias as the first one, "
+                 << __FILE__ << "," << __LINE__ << endl;
+            throw(std::runtime_error("Inconsistent bias of shards!"));
+        }
+        headers_.push_back(header);
+        shard_begin_.push_back(dataset_->n_samples);
+
+        // targets are kept in memory
+        dataset_->y.resize(dataset_->n_samples + header.n_samples);
+        read_at(fd, &dataset_->y[dataset_->n_samples], header.n_samples * sizeof(double), header.y_offset);
+        std::vector<double> labels(header.n_classes);
+        read_at(fd, labels.data(), header.n_classes * sizeof(double), header.labels_offset);
+        classes.insert(labels.begin(), labels.end());
+
+        dataset_->n_samples += header.n_samples;
+        dataset_->dimension = std::max<size_t>(dataset_->dimension, header.dimension);
+        dataset_->bias = header.bias;
+        nnz_ += header.nnz;
+    }
+    dataset_->labels.assign(classes.begin(), classes.end());
+    dataset_->n_classes = classes.size();
+}
+
+DatasetStream::~DatasetStream()
+{
+    for(size_t s = 0; s < fds_.size(); ++s)
+        close(fds_[s]);
+}
+
+/**
+ * Targets and labels of the whole dataset, the features X is NULL
+ */
+DatasetPtr
+DatasetStream::dataset() const
+{
+    return dataset_;
+}
+
+/**
+ * Read samples [begin, end) of a shard
+ *
+ * @param s     shard index
+ * @param begin first sample in shard
+ * @param end   past the last sample in shard
+ * @param block output block
+ */
+void
+DatasetStream::read_block(size_t s, size_t begin, size_t end, DatasetBlock& block) const
+{
+    const DatasetFileHeader& header = headers_[s];
+    const int fd = fds_[s];
+    block.begin = shard_begin_[s] + begin;
+    block.n_samples = end - begin;
+    block.outer.resize(end - begin + 1);
+    read_at(fd, block.outer.data(), block.outer.size() * sizeof(FeatureIndex),
+            header.outer_offset + begin * sizeof(FeatureIndex));
+    // rebase the offsets to the block
+    const FeatureIndex first = block.outer[0];
+    for(size_t i = 0; i < block.outer.size(); ++i)
+        block.outer[i] -= first;
+    const size_t nnz = block.outer.back();
+
+    block.inner.resize(nnz);
+    read_at(fd, block.inner.data(), nnz * sizeof(FeatureIndex),
+            header.inner_offset + first * sizeof(FeatureIndex));
+    if(header.flags & kBinaryFeatures)
+        block.values.clear();
+    else
+    {
+        block.values.resize(nnz);
+        read_at(fd, block.values.data(), nnz * sizeof(FeatureScalar),
+                header.value_offset + first * sizeof(FeatureScalar));
+    }
+
+    // the bias feature is the last feature of every shard
+    if(header.bias > 0 && header.dimension != dataset_->dimension)
+    {
+        const FeatureIndex shard_bias = header.dimension - 1;
+        for(size_t k = 0; k < nnz; ++k)
+        {
+            if(block.inner[k] == shard_bias)
+                block.inner[k] = dataset_->dimension - 1;
+        }
+    }
+}
+
+/**
+ * Run fn on every block of samples in order. The next block is read by
+ * another thread while fn runs on the current one, so at most two blocks
+ * are in memory.
+ *
+ * @param fn function of a block
+ */
+void
+DatasetStream::for_each_block(std::function<void(const DatasetBlock&)> fn)
+{
+    // (shard, first sample in shard) of all blocks
+    std::vector<std::pair<size_t, size_t> > blocks;
+    for(size_t s = 0; s < headers_.size(); ++s)
+    {
+        for(size_t begin = 0; begin < headers_[s].n_samples; begin += block_size_)
+            blocks.push_back(std::make_pair(s, begin));
+    }
+    if(blocks.empty())
+        return;
+
+    DatasetBlock buffers[2];
+    auto read = [&](size_t b, DatasetBlock& block)
+    {
+        const size_t s = blocks[b].first, begin = blocks[b].second;
+        read_block(s, begin, std::min<size_t>(begin + block_size_, headers_[s].n_samples), block);
+    };
+    read(0, buffers[0]);
+    for(size_t b = 0; b < blocks.size(); ++b)
+    {
+        std::thread prefetch;
+        std::exception_ptr error;
+        if(b + 1 < blocks.size())
+        {
+            prefetch = std::thread([&, b]()
+            {
+                try
+                {
+                    read(b + 1, buffers[(b + 1) % 2]);
+                }
+                catch(...)
+                {
+                    error = std::current_exception();
+                }
+            });
+        }
+        try
+        {
+            fn(buffers[b % 2]);
+        }
+        catch(...)
+        {
+            if(prefetch.joinable())
+                prefetch.join();
+            throw;
+        }
+        if(prefetch.joinable())
+            prefetch.join();
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
+
+} // oplin
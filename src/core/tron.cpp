@@ -0,0 +1,196 @@
+// Trust region Newton method
+//
+// Each epoch solves the Newton system H s = -g approximately by
+// conjugate gradient within the trust region ||s|| <= delta, in which
+// every iteration costs one Hessian-vector product (a pass over dataset)
+// and no Hessian is ever formed.
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <cmath>
+#include "solver.hpp"
+
+namespace oplin
+{
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+TRON::TRON() : max_cg_iter_(250) {}
+TRON::~TRON(){}
+
+/**
+ * Approximately minimize g^T s + 0.5 * s^T H s subject to ||s|| <= delta
+ * by conjugate gradient. The step s is stored in p_ and the residual
+ * -(g + H s) in r_.
+ *
+ * @param problem
+ * @param w       weights
+ * @param delta   trust region radius
+ *
+ * @return number of conjugate gradient iterations
+ */
+size_t
+TRON::trust_region_cg(ProblemPtr problem, const Eigen::Ref<const ColVector>& w, const double& delta)
+{
+    // stop when the residual is reduced enough relative to the gradient
+    const double cg_tol = 0.1 * steepest_grad_.norm();
+    p_.setZero();
+    r_ = -steepest_grad_;
+    d_ = r_;
+    double rTr = r_.squaredNorm();
+    size_t cg_iter = 0;
+
+    while(cg_iter < max_cg_iter_)
+    {
+        if(std::sqrt(rTr) <= cg_tol)
+            break;
+        cg_iter++;
+        problem->hessian_vector(w, d_, Hd_);
+        problem->regularized_hessian_vector(w, d_, Hd_);
+
+        double alpha = rTr / d_.dot(Hd_);
+        p_.noalias() += alpha * d_;
+        if(p_.norm() > delta)
+        {
+            // move back and stop on the boundary of trust region
+            p_.noalias() -= alpha * d_;
+            const double sTd = p_.dot(d_);
+            const double sTs = p_.squaredNorm();
+            const double dTd = d_.squaredNorm();
+            const double dsq = delta * delta;
+            const double rad = std::sqrt(sTd * sTd + dTd * (dsq - sTs));
+            if(sTd >= 0)
+                alpha = (dsq - sTs) / (sTd + rad);
+            else
+                alpha = (rad - sTd) / dTd;
+            p_.noalias() += alpha * d_;
+            r_.noalias() -= alpha * Hd_;
+            break;
+        }
+        r_.noalias() -= alpha * Hd_;
+        const double rnewTrnew = r_.squaredNorm();
+        d_ = (rnewTrnew / rTr) * d_ + r_;
+        rTr = rnewTrnew;
+    }
+    return cg_iter;
+}
+
+/**
+ * Solve the problem on dataset with parameters
+ *
+ * @param problem Problem instance, which supports Hessian-vector product
+ * @param param   Parameter instance
+ * @param w       weights for optimize
+ *
+ */
+void
+TRON::solve(ProblemPtr problem, ParamPtr param, Eigen::Ref<ColVector>& w)
+{
+    // constants of trust region update in Lin, Weng and Keerthi's paper
+    const double eta0 = 1e-4, eta1 = 0.25, eta2 = 0.75;
+    const double sigma1 = 0.25, sigma2 = 0.5, sigma3 = 4;
+
+    if(!problem->init_hessian())
+    {
+        cerr << "TRON::solve : problem does not support Hessian-vector product, "
+             << __FILE__ << "," << __LINE__ << endl;
+        throw(std::invalid_argument("problem not supported by TRON"));
+    }
+
+    // initializations
+    steepest_grad_ = ColVector::Zero(w.rows(),1);
+    loss_ = problem->loss_and_gradient(w, steepest_grad_);
+    problem->regularized_gradient(w, steepest_grad_);
+    next_grad_ = ColVector::Zero(w.rows(),1);
+    next_loss_ = loss_;
+    next_w_ = w;
+    p_ = ColVector::Zero(w.rows(),1);
+    Hd_ = ColVector::Zero(w.rows(),1);
+    double delta = steepest_grad_.norm();
+    double rela_improve = 0;
+    size_t cg_iter = 0;
+
+    // check if the weights already optimized
+    if(loss_ < param->abs_tol)
+    {
+        return;
+        VOUT("Already optimized weights get!");
+    }
+
+    // -- debug print
+    VOUT("\n*** To disable debug info: $ make DISABLE_DEBUG=yes ***\n");
+    VOUT("|%5s|%15s|%15s|%5s|%15s|\n","Epoch","Loss","Improve","#cg","Radius");
+
+    for(epoch_ = 0; epoch_ < param->max_epoch; ++epoch_)
+    {
+
+        /*** Iteration - k ***/
+
+        /// 01 - Truncated Newton step p within trust region
+        cg_iter = trust_region_cg(problem, w, delta);
+        next_w_.noalias() = w + p_;
+        // the gradient and Hessian diagonal at next_w_ are needed if the
+        // step is accepted, which is the common case
+        next_loss_ = problem->loss_and_gradient(next_w_, next_grad_);
+
+        /// 02 - Update trust region radius by the ratio of actual and
+        //       predicted reduction
+        const double gTs = steepest_grad_.dot(p_);
+        const double predicted = -0.5 * (gTs - p_.dot(r_));
+        const double actual = loss_ - next_loss_;
+        const double snorm = p_.norm();
+        if(epoch_ == 0)
+            delta = std::min(delta, snorm);
+        double alpha;
+        if(next_loss_ - loss_ - gTs <= 0)
+            alpha = sigma3;
+        else
+            alpha = std::max(sigma1, -0.5 * (gTs / (next_loss_ - loss_ - gTs)));
+
+        if(actual < eta0 * predicted)
+            delta = std::min(std::max(alpha, sigma1) * snorm, sigma2 * delta);
+        else if(actual < eta1 * predicted)
+            delta = std::max(sigma1 * delta, std::min(alpha * snorm, sigma2 * delta));
+        else if(actual < eta2 * predicted)
+            delta = std::max(sigma1 * delta, std::min(alpha * snorm, sigma3 * delta));
+        else
+            delta = std::max(delta, std::min(alpha * snorm, sigma3 * delta));
+
+        VOUT("|%5d|%15.4f|%15.6f|%5d|%15.6f|\n",epoch_,next_loss_,actual / loss_,cg_iter,delta);
+
+        /// 03 - Rejected step, retry with smaller radius. The Hessian
+        //       diagonal is evaluated again at w
+        if(actual <= eta0 * predicted)
+        {
+            if(predicted <= 0 || delta < 1e-12 * w.norm())
+            {
+                VOUT("Trust region too small, stop.\n");
+                break;
+            }
+            problem->loss_and_gradient(w, next_grad_);
+            continue;
+        }
+
+        /// 04 - Termination Check
+        rela_improve = fabs(actual / loss_);
+        if(rela_improve < param->rela_tol || next_loss_ < param->abs_tol)
+        {
+            // assign next_w_ to w as return value
+            w.swap(next_w_);
+            break;
+        }
+
+        /// 05 - Update varaiables
+        steepest_grad_.swap(next_grad_);
+        problem->regularized_gradient(next_w_, steepest_grad_);
+        loss_ = next_loss_;
+        w.swap(next_w_);
+    }
+}
+
+} // oplin
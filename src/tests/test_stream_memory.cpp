@@ -0,0 +1,159 @@
+// Out-of-core training test: a dataset several times larger than a memory
+// limit is converted into binary shards, and train -S trains on the
+// streamed shards under that limit (RLIMIT_AS of the train process).
+//
+// The libsvm shards are written a line at a time, converted by convert
+// and removed, so no process holds the whole dataset. The train and
+// convert tools are run from the directory of this test.
+//
+// Usage: test_stream_memory [limit_mb] [n_shards] [samples_per_shard] [nnz_per_sample]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/** the dataset is at least kMinRatio times larger than the limit */
+static const double kMinRatio = 3;
+
+/**
+ * Run a tool with its output discarded, under a limit of address space
+ * if limit_bytes is not 0
+ *
+ * @return true if the tool exits successfully
+ */
+static bool run(const std::vector<std::string>& args, size_t limit_bytes = 0)
+{
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        if(limit_bytes)
+        {
+            struct rlimit limit = {limit_bytes, limit_bytes};
+            setrlimit(RLIMIT_AS, &limit);
+        }
+        std::vector<char*> argv;
+        for(size_t k = 0; k < args.size(); ++k)
+            argv.push_back(const_cast<char*>(args[k].c_str()));
+        argv.push_back(NULL);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * Write a libsvm shard of random sparse samples labeled by the hyperplane
+ * w_true with 10% of the labels flipped
+ */
+static bool write_shard(const std::string& filename, size_t n_samples, size_t nnz_per_sample,
+                        const std::vector<double>& w_true, std::mt19937& gen)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+        return false;
+    std::uniform_int_distribution<size_t> feature(0, w_true.size() - 1);
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<size_t> features(nnz_per_sample);
+    std::vector<double> values(nnz_per_sample);
+    for(size_t i = 0; i < n_samples; ++i)
+    {
+        for(size_t k = 0; k < nnz_per_sample; ++k)
+            features[k] = feature(gen);
+        std::sort(features.begin(), features.end());
+        features.erase(std::unique(features.begin(), features.end()), features.end());
+        double wTx = 0;
+        for(size_t k = 0; k < features.size(); ++k)
+        {
+            values[k] = value(gen);
+            wTx += w_true[features[k]] * values[k];
+        }
+        fprintf(file, "%d", (wTx > 0) != (value(gen) > 0.8) ? 1 : -1);
+        for(size_t k = 0; k < features.size(); ++k)
+            fprintf(file, " %zu:%.4f", features[k] + 1, values[k]);
+        fputc('\n', file);
+        features.resize(nnz_per_sample);
+    }
+    return fclose(file) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t limit_mb = argc > 1 ? atoi(argv[1]) : 200;
+    const size_t n_shards = argc > 2 ? atoi(argv[2]) : 18;
+    const size_t samples_per_shard = argc > 3 ? atoi(argv[3]) : 100000;
+    const size_t nnz_per_sample = argc > 4 ? atoi(argv[4]) : 30;
+    const size_t dimension = 100000;
+
+    std::string bin_dir(argv[0]);
+    bin_dir = bin_dir.find('/') == std::string::npos ? "." : bin_dir.substr(0, bin_dir.rfind('/'));
+    char tmp_dir[] = "/tmp/test_stream_memory_XXXXXX";
+    if(!mkdtemp(tmp_dir))
+    {
+        printf("FAIL : could not create a temporary directory\n");
+        return EXIT_FAILURE;
+    }
+    const std::string dir(tmp_dir);
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<double> w_true(dimension);
+    for(size_t k = 0; k < dimension; ++k)
+        w_true[k] = value(gen);
+
+    bool ok = true;
+    std::string shards;
+    std::vector<std::string> files;
+    size_t dataset_bytes = 0;
+    for(size_t s = 0; s < n_shards && ok; ++s)
+    {
+        const std::string text = dir + "/shard_" + std::to_string(s) + ".txt";
+        const std::string binary = dir + "/shard_" + std::to_string(s) + ".dat";
+        ok = write_shard(text, samples_per_shard, nnz_per_sample, w_true, gen) &&
+             run({bin_dir + "/convert", text, binary});
+        unlink(text.c_str());
+        files.push_back(binary);
+        struct stat st;
+        if(ok && stat(binary.c_str(), &st) == 0)
+            dataset_bytes += st.st_size;
+        shards += (s ? "," : "") + binary;
+    }
+    const size_t limit_bytes = limit_mb << 20;
+    printf("dataset : %zu shards, %zu MB, limit : %zu MB\n", n_shards, dataset_bytes >> 20, limit_mb);
+
+    const std::string model = dir + "/model";
+    files.push_back(model);
+    bool passed = false;
+    if(!ok)
+        printf("FAIL : could not write and convert the shards\n");
+    else if(dataset_bytes < kMinRatio * limit_bytes)
+        printf("FAIL : the dataset is not %g times larger than the limit\n", kMinRatio);
+    else if(!run({bin_dir + "/train", "-s", "2", "-p", "1", "-m", "10", "-S", "4096", shards, model},
+                 limit_bytes))
+        printf("FAIL : train -S failed under the memory limit\n");
+    else
+        passed = true;
+
+    for(size_t k = 0; k < files.size(); ++k)
+        unlink(files[k].c_str());
+    rmdir(tmp_dir);
+    if(!passed)
+        return EXIT_FAILURE;
+    printf("PASS\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+// Memory regression test of training: the peak RSS of loading a mapped
+// binary dataset and training on it stays close to the size of the
+// dataset, i.e. training does not copy the features X (e.g. to group the
+// samples by class).
+//
+// The dataset is generated and saved by a child process, so the peak RSS
+// of this process is not raised by the generation.
+//
+// Usage: test_train_memory [n_samples] [dimension] [nnz_per_sample] [n_classes]
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "logistic.hpp"
+#include "high_level_function.hpp"
+#include "../benchmark/synthetic_dataset.hpp"
+
+/** peak RSS growth allowed, times the size of the binary dataset */
+static const double kMaxGrowth = 1.5;
+/** and the buffers of the process and of the solver not in dataset, KB */
+static const size_t kSlackKB = 16 * 1024;
+
+int main(int argc, char **argv)
+{
+    const size_t n_samples = argc > 1 ? atoi(argv[1]) : 500000;
+    const size_t dimension = argc > 2 ? atoi(argv[2]) : 10000;
+    const size_t nnz_per_sample = argc > 3 ? atoi(argv[3]) : 30;
+    const size_t n_classes = argc > 4 ? atoi(argv[4]) : 2;
+    char filename[] = "/tmp/test_train_memory_XXXXXX";
+    int fd = mkstemp(filename);
+    if(fd < 0)
+    {
+        printf("FAIL : could not create a temporary file\n");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        oplin::DatasetPtr dataset = synthetic_dataset(n_samples, dimension, nnz_per_sample);
+        if(n_classes > 2)
+        {
+            // classes by the first feature of every sample
+            dataset->labels.clear();
+            for(size_t c = 0; c < n_classes; ++c)
+                dataset->labels.push_back(c);
+            const oplin::SpColMatrixMap& X = *(dataset->X);
+            for(size_t i = 0; i < n_samples; ++i)
+                dataset->y[i] = X.innerIndexPtr()[X.outerIndexPtr()[i]] % n_classes;
+            dataset->n_classes = n_classes;
+        }
+        oplin::save_dataset_binary(dataset, filename);
+        _exit(EXIT_SUCCESS);
+    }
+    int status;
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        printf("FAIL : could not generate the dataset\n");
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    struct stat st;
+    stat(filename, &st);
+    const size_t dataset_kb = st.st_size / 1024;
+
+    oplin::ParamPtr param = std::make_shared<oplin::Parameter>();
+    param->solver_type = oplin::L_BFGS;
+    param->problem_type = oplin::L2R_LR;
+    param->rela_tol = 1e-5;
+    param->abs_tol = 0.1;
+    param->max_epoch = 20;
+    param->learning_rate = 0.01;
+    param->base_C = 1;
+
+    const size_t before_kb = oplin::peak_rss_kb();
+    {
+        oplin::DatasetPtr dataset = oplin::read_dataset(filename);
+        oplin::LogisticRegression lr;
+        lr.train(dataset, param);
+    }
+    const size_t growth_kb = oplin::peak_rss_kb() - before_kb;
+    unlink(filename);
+
+    const size_t limit_kb = kMaxGrowth * dataset_kb + kSlackKB;
+    printf("dataset : %zu KB, peak RSS growth of training : %zu KB, limit : %zu KB\n",
+           dataset_kb, growth_kb, limit_kb);
+    if(growth_kb > limit_kb)
+    {
+        printf("FAIL : training takes too much memory for the dataset\n");
+        return EXIT_FAILURE;
+    }
+    printf("PASS\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+// Test of warm start (see Parameter::warm_start and LinearBase::partial_fit)
+// on a binary dataset of labels other than +1/-1:
+//
+// - training keeps the targets of the dataset, which is trained again by
+//   partial_fit and by a warm start to a regularized loss no higher
+// - on a window of samples shifted by new ones, the warm start from the
+//   model of the former window has a lower regularized loss than the
+//   training from scratch, before any epoch and after the same few epochs
+// - the model grown by new features, a new bias and swapped labels by
+//   partial_fit predicts the same probabilities before any epoch, i.e. the
+//   weights are mapped with the sign of the positive label and the bias
+//   weight rescaled to the same bias term
+// - the curvature pairs of L-BFGS are kept for more weights, padded by
+//   zeros, and dropped for fewer weights
+//
+// Usage: test_warm_start
+//
+// @author: Bingqing Qu
+//
+// Copyright (C) 2014-2015  Bingqing Qu <sylar.qu@gmail.com>
+//
+// @license: See LICENSE at root directory
+#include <cmath>
+#include "logistic.hpp"
+#include "solver.hpp"
+#include "../benchmark/synthetic_dataset.hpp"
+
+typedef Eigen::Triplet<oplin::FeatureScalar, oplin::FeatureIndex> Triplet;
+
+/**
+ * Samples [begin, begin + n) of dataset, with extra new features of which
+ * every sample has one, and a bias feature last if bias > 0
+ */
+static oplin::DatasetPtr resized(const oplin::Dataset& dataset, size_t begin, size_t n,
+                                 size_t extra, double bias)
+{
+    oplin::DatasetPtr result = std::make_shared<oplin::Dataset>();
+    result->n_samples = n;
+    result->dimension = dataset.dimension + extra + (bias > 0 ? 1 : 0);
+    result->n_classes = dataset.n_classes;
+    result->labels = dataset.labels;
+    result->bias = bias;
+    result->y.assign(dataset.y.begin() + begin, dataset.y.begin() + begin + n);
+
+    std::vector<Triplet> triplets;
+    for(size_t i = 0; i < n; ++i)
+    {
+        for(oplin::SpColMatrixMap::InnerIterator it(*(dataset.X), begin + i); it; ++it)
+            triplets.push_back(Triplet(it.index(), i, it.value()));
+        if(extra)
+            triplets.push_back(Triplet(dataset.dimension + i % extra, i, 1));
+        if(bias > 0)
+            triplets.push_back(Triplet(result->dimension - 1, i, bias));
+    }
+    oplin::SpColMatrixPtr X = std::make_shared<oplin::SpColMatrix>(result->dimension, n);
+    X->setFromTriplets(triplets.begin(), triplets.end());
+    result->set_X(X);
+    return result;
+}
+
+/** probability of every label of dataset (in the order of dataset->labels) of every sample */
+static std::vector<double> label_probability(oplin::LogisticRegression& lr, const oplin::Dataset& dataset)
+{
+    const size_t n = dataset.n_samples;
+    std::vector<double> labels(n), probability(n * 2), result(n * 2);
+    lr.predict_batch(*(dataset.X), labels.data(), probability.data());
+    const std::vector<double> model_labels = lr.get_labels();
+    const size_t c = dataset.labels[0] == model_labels[0] ? 0 : 1;
+    for(size_t i = 0; i < n; ++i)
+    {
+        result[i * 2] = probability[i * 2 + c];
+        result[i * 2 + 1] = probability[i * 2 + 1 - c];
+    }
+    return result;
+}
+
+/** fraction of the samples of dataset predicted right */
+static double accuracy(oplin::LogisticRegression& lr, const oplin::Dataset& dataset)
+{
+    std::vector<double> labels(dataset.n_samples);
+    lr.predict_batch(*(dataset.X), labels.data());
+    size_t n_correct = 0;
+    for(size_t i = 0; i < dataset.n_samples; ++i)
+        n_correct += labels[i] == dataset.y[i];
+    return (double)n_correct / dataset.n_samples;
+}
+
+/** dataset of targets +1 for the first label and -1, as trained by LR_Problem */
+static oplin::DatasetPtr signed_targets(const oplin::Dataset& dataset)
+{
+    oplin::DatasetPtr result = std::make_shared<oplin::Dataset>(dataset);
+    result->labels = {+1, -1};
+    for(size_t i = 0; i < result->n_samples; ++i)
+        result->y[i] = dataset.y[i] == dataset.labels[0] ? +1 : -1;
+    return result;
+}
+
+/** regularized loss of the model of lr on dataset, minimized by the solvers */
+static double objective(oplin::LogisticRegression& lr, const oplin::Dataset& dataset)
+{
+    oplin::ModelUniPtr model = lr.export_model();
+    oplin::ColVector w(dataset.dimension);
+    model->dense_weights(w.data());
+    const std::vector<double> C(dataset.n_samples, 1);
+    lr.load_model(std::move(model));
+    oplin::L2R_LR_Problem problem(signed_targets(dataset), C);
+    return problem.loss(w);
+}
+
+/** a copy of param trained max_epoch epochs, from the trained model if warm_start */
+static oplin::ParamPtr budget(const oplin::ParamPtr param, size_t max_epoch, bool warm_start)
+{
+    oplin::ParamPtr result = std::make_shared<oplin::Parameter>(*param);
+    result->max_epoch = max_epoch;
+    result->warm_start = warm_start;
+    return result;
+}
+
+/** retrain the model of dataset on the new targets, see the header */
+static bool test_targets(const oplin::DatasetPtr dataset, const oplin::ParamPtr param)
+{
+    const std::vector<double> y = dataset->y;
+    oplin::LogisticRegression lr;
+    lr.train(dataset, param);
+    if(dataset->y != y)
+    {
+        printf("FAIL : train changed the targets of dataset\n");
+        return false;
+    }
+    const double trained = accuracy(lr, *dataset);
+    const double trained_loss = objective(lr, *dataset);
+
+    lr.partial_fit(dataset);
+    const double partial = accuracy(lr, *dataset);
+    const double partial_loss = objective(lr, *dataset);
+    lr.train(dataset, budget(param, param->max_epoch, true));
+    const double warm = accuracy(lr, *dataset);
+    const double warm_loss = objective(lr, *dataset);
+
+    printf("accuracy : trained %f, partial_fit %f, warm start %f\n", trained, partial, warm);
+    printf("loss : trained %f, partial_fit %f, warm start %f\n", trained_loss, partial_loss, warm_loss);
+    if(std::min(trained, std::min(partial, warm)) < 0.8 || partial_loss > trained_loss ||
+       warm_loss > partial_loss)
+    {
+        printf("FAIL : retrained models are worse than the trained one\n");
+        return false;
+    }
+    return true;
+}
+
+/** warm start against training from scratch, see the header */
+static bool test_objective(const oplin::DatasetPtr dataset, const oplin::ParamPtr param)
+{
+    const size_t window = dataset->n_samples * 9 / 10;
+    oplin::DatasetPtr former = resized(*dataset, 0, window, 0, -1);
+    oplin::DatasetPtr shifted = resized(*dataset, dataset->n_samples - window, window, 0, -1);
+
+    const size_t epochs[] = {0, 3};
+    for(size_t k = 0; k < 2; ++k)
+    {
+        oplin::LogisticRegression cold, warm;
+        cold.train(shifted, budget(param, epochs[k], false));
+        warm.train(former, param);
+        warm.train(shifted, budget(param, epochs[k], true));
+        const double cold_loss = objective(cold, *shifted);
+        const double warm_loss = objective(warm, *shifted);
+        printf("loss after %zu epochs : cold %f, warm start %f\n", epochs[k], cold_loss, warm_loss);
+        if(!(warm_loss < cold_loss))
+        {
+            printf("FAIL : warm start is not ahead of training from scratch\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+/** dimension growth of partial_fit, see the header */
+static bool test_growth(const oplin::DatasetPtr dataset, const oplin::ParamPtr param)
+{
+    const size_t n = dataset->n_samples / 2;
+    oplin::DatasetPtr former = resized(*dataset, 0, n, 0, 1);
+    oplin::LogisticRegression lr;
+    lr.train(former, param);
+    const std::vector<double> trained = label_probability(lr, *former);
+    const double trained_accuracy = accuracy(lr, *former);
+
+    // the same samples with 100 new features, bias 2 and the other label positive
+    oplin::DatasetPtr grown = resized(*dataset, 0, n, 100, 2);
+    std::swap(grown->labels[0], grown->labels[1]);
+    lr.partial_fit(grown, oplin::ParamPtr(), 0);
+    // in the order of the labels of former
+    const std::vector<double> seeded = label_probability(lr, *grown);
+    double max_delta = 0;
+    for(size_t k = 0; k < trained.size(); ++k)
+        max_delta = std::max(max_delta, std::fabs(trained[k] - seeded[k ^ 1]));
+
+    lr.partial_fit(grown);
+    printf("grown model : max probability delta %g before training\n", max_delta);
+    if(max_delta > 1e-9)
+    {
+        printf("FAIL : the grown model does not start from the trained one\n");
+        return false;
+    }
+    if(accuracy(lr, *grown) < trained_accuracy - 0.01 || trained_accuracy < 0.8)
+    {
+        printf("FAIL : the grown model lost accuracy\n");
+        return false;
+    }
+    return true;
+}
+
+/** curvature pairs of L-BFGS on other numbers of weights, see the header */
+static bool test_history(const oplin::DatasetPtr dataset, const oplin::ParamPtr param)
+{
+    const size_t dimension = dataset->dimension;
+    const size_t extra = 50;
+    oplin::DatasetPtr former = signed_targets(*dataset);
+    oplin::DatasetPtr grown = resized(*former, 0, former->n_samples, extra, -1);
+    const std::vector<double> C(former->n_samples, 1);
+
+    oplin::LBFGS lbfgs;
+    oplin::ColVector w = oplin::ColVector::Zero(dimension);
+    Eigen::Ref<oplin::ColVector> w_ref(w);
+    lbfgs.solve(std::make_shared<oplin::L2R_LR_Problem>(former, C), budget(param, 5, false), w_ref);
+    std::vector<oplin::ColVector> s, y;
+    for(size_t k = 0; k < lbfgs.get_s_list().size(); ++k)
+    {
+        s.push_back(*lbfgs.get_s_list()[k]);
+        y.push_back(*lbfgs.get_y_list()[k]);
+    }
+
+    // no epoch, the pairs are only resized
+    oplin::ColVector grown_w = oplin::ColVector::Zero(dimension + extra);
+    grown_w.head(dimension) = w;
+    Eigen::Ref<oplin::ColVector> grown_ref(grown_w);
+    lbfgs.solve(std::make_shared<oplin::L2R_LR_Problem>(grown, C), budget(param, 0, false), grown_ref);
+    bool kept = !s.empty() && lbfgs.get_s_list().size() == s.size();
+    for(size_t k = 0; kept && k < s.size(); ++k)
+    {
+        const oplin::ColVector& s_k = *lbfgs.get_s_list()[k];
+        const oplin::ColVector& y_k = *lbfgs.get_y_list()[k];
+        kept = (size_t)s_k.rows() == dimension + extra && (size_t)y_k.rows() == dimension + extra &&
+               s_k.head(dimension) == s[k] && y_k.head(dimension) == y[k] &&
+               s_k.tail(extra).isZero(0) && y_k.tail(extra).isZero(0);
+    }
+    printf("L-BFGS : %zu curvature pairs resized to %zu weights\n", s.size(), dimension + extra);
+    if(!kept)
+    {
+        printf("FAIL : the curvature pairs are not kept with zeros for the new weights\n");
+        return false;
+    }
+
+    lbfgs.solve(std::make_shared<oplin::L2R_LR_Problem>(former, C), budget(param, 0, false), w_ref);
+    if(!lbfgs.get_s_list().empty() || !lbfgs.get_y_list().empty())
+    {
+        printf("FAIL : the curvature pairs are kept for fewer weights\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    oplin::DatasetPtr dataset = synthetic_dataset(30000, 1000, 20);
+    // labels 0 and 1 instead of +1 and -1
+    for(size_t i = 0; i < dataset->n_samples; ++i)
+        dataset->y[i] = dataset->y[i] > 0 ? 1 : 0;
+    dataset->labels = {0, 1};
+
+    oplin::ParamPtr param = std::make_shared<oplin::Parameter>();
+    param->solver_type = oplin::L_BFGS;
+    param->problem_type = oplin::L2R_LR;
+    param->rela_tol = 1e-5;
+    param->abs_tol = 0.1;
+    param->max_epoch = 500;
+    param->learning_rate = 0.01;
+    param->base_C = 1;
+
+    if(!test_targets(dataset, param) || !test_objective(dataset, param) ||
+       !test_growth(dataset, param) || !test_history(dataset, param))
+        return EXIT_FAILURE;
+    printf("PASS\n");
+    return EXIT_SUCCESS;
+}